@@ -2,14 +2,25 @@
 #define __ALGORITHM_H__
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
 #include <functional>
 #include <iterator>
-#include <stack>
+#include <memory>
+#include <new>
+#include <numeric>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include "fakeconcepts.h"
+#include "execution.h"
 #include "functional.h"
+#include "simd.h"
 
 namespace xp {
 
@@ -25,6 +36,32 @@ I find_backward_with_not_found_value(I first, I last, I not_found, const T& val)
 	return not_found;
 }
 
+template<BidirectionalIterator I, typename T>
+I find_backward(I first, I last, const T& val, std::false_type) {
+	return find_backward_with_not_found_value(first, last, last, val);
+}
+
+template<typename U, typename T>
+U* find_backward(U* first, U* last, const T& val, std::true_type) {
+	return first + (simd::find_backward(static_cast<const T*>(first), static_cast<const T*>(last), val) - first);
+}
+
+template<InputIterator I, Integer N, typename T>
+std::pair<I, N> find_n(I first, N n, const T& val, std::false_type)
+{ // adapted from EoP
+	while (n && *first != val) {
+		--n;
+		++first;
+	}
+	return{ first, n };
+}
+
+template<typename U, Integer N, typename T>
+std::pair<U*, N> find_n(U* first, N n, const T& val, std::true_type) {
+	auto found = simd::find(static_cast<const T*>(first), static_cast<const T*>(first + n), val) - first;
+	return{ first + found, N(n - found) };
+}
+
 template<BidirectionalIterator I, UnaryPredicate Pred>
 I find_if_backward_with_not_found_value(I first, I last, I not_found, Pred pred) {
 	auto it = last;
@@ -65,11 +102,160 @@ struct negate {
 	}
 };
 
+template<ForwardIterator I>
+struct cost_extrema {
+	I min;       // first minimum
+	I max_first; // first maximum
+	I max_last;  // last maximum
+};
+
+// True when the costs are evaluated by blocks and compared by the SIMD kernels.
+template<typename I, typename Cost>
+struct has_vectorized_costs : std::integral_constant<bool,
+	std::is_base_of<std::random_access_iterator_tag, typename std::iterator_traits<I>::iterator_category>::value
+	&& simd::has_bounds<typename std::decay<decltype(std::declval<Cost&>()(*std::declval<I>()))>::type>::value> {};
+
+// The costs are evaluated in order, once per element, by blocks cached on the stack.
+// The SIMD kernels find the bounds of a block and, only when they improve the extrema so far,
+// their positions. A block the kernels cannot handle is compared cost by cost, as by the scalar algorithms.
+// c is the cost of the first element.
+template<RandomAccessIterator I, Function Cost, typename C>
+cost_extrema<I> cost_extrema_by_blocks(I first, I last, Cost& cost, C c) {
+	const std::ptrdiff_t block = 256;
+	C costs[block];
+
+	cost_extrema<I> r = {first, first, first};
+	C lowest = c;
+	C highest = lowest;
+	++first;
+	while (first != last) {
+		auto n = std::min(block, static_cast<std::ptrdiff_t>(last - first));
+		for (std::ptrdiff_t i = 0; i != n; ++i)
+			costs[i] = cost(first[i]);
+		simd::bounds<C> b;
+		if (simd::find_bounds(costs, n, b)) {
+			if (b.min < lowest) {
+				lowest = b.min;
+				r.min = first + (simd::find(costs, costs + n, b.min) - costs);
+			}
+			if (highest < b.max) {
+				highest = b.max;
+				r.max_first = first + (simd::find(costs, costs + n, b.max) - costs);
+				r.max_last = first + (simd::find_backward(costs, costs + n, b.max) - costs);
+			}
+			else if (!(b.max < highest)) {
+				r.max_last = first + (simd::find_backward(costs, costs + n, b.max) - costs);
+			}
+		}
+		else {
+			for (std::ptrdiff_t i = 0; i != n; ++i) {
+				auto val = costs[i];
+				if (val < lowest) {
+					lowest = val;
+					r.min = first + i;
+				}
+				if (highest < val) {
+					highest = val;
+					r.max_first = r.max_last = first + i;
+				}
+				else if (!(val < highest)) {
+					r.max_last = first + i;
+				}
+			}
+		}
+		first += n;
+	}
+	return r;
+}
+
+template<RandomAccessIterator I, Function Cost>
+cost_extrema<I> cost_extrema_nonempty(I first, I last, Cost cost) {
+	typedef typename std::decay<decltype(cost(*first))>::type C;
+	C c = cost(*first);
+	if (c == c) return cost_extrema_by_blocks(first, last, cost, c);
+
+	// a first NaN compares false with every cost: as in the scalar algorithms, the minimum and the first
+	// maximum stay at it, while the last maximum moves to each next cost until one is not NaN,
+	// from which the others are compared by blocks.
+	cost_extrema<I> r = {first, first, first};
+	do {
+		if (++first == last) return r;
+		r.max_last = first;
+		c = cost(*first);
+	} while (c != c);
+	r.max_last = cost_extrema_by_blocks(first, last, cost, c).max_last;
+	return r;
+}
+
+template<ForwardIterator I, Function Cost, Relation Compare>
+I cost_element_nonempty(I first, I last, Cost cost, Compare cmp, I cost_extrema<I>::*, std::false_type) {
+	return compare_cost_element_nonempty(first, last, cost, cmp);
+}
+
+template<RandomAccessIterator I, Function Cost, Relation Compare>
+I cost_element_nonempty(I first, I last, Cost cost, Compare, I cost_extrema<I>::* member, std::true_type) {
+	return cost_extrema_nonempty(first, last, cost).*member;
+}
+
+// The elements are processed by pairs, so that the cost function is called N times
+// and the costs are compared at most 3/2 N times.
+template<ForwardIterator I, Function Cost>
+std::pair<I, I> minmax_cost_element_nonempty(I first, I last, Cost cost, std::false_type) {
+	auto min = first;
+	auto max = first;
+	auto lowest = cost(*first);
+	auto highest = lowest;
+	while (++first != last) {
+		auto i = first;
+		auto a = cost(*i);
+		if (++first == last) {
+			if (a < lowest) {
+				lowest = a;
+				min = i;
+			}
+			else if (!(a < highest)) {
+				highest = a;
+				max = i;
+			}
+			break;
+		}
+		auto b = cost(*first);
+		if (b < a) {
+			if (b < lowest) {
+				lowest = b;
+				min = first;
+			}
+			if (!(a < highest)) {
+				highest = a;
+				max = i;
+			}
+		}
+		else {
+			if (a < lowest) {
+				lowest = a;
+				min = i;
+			}
+			if (!(b < highest)) {
+				highest = b;
+				max = first;
+			}
+		}
+	}
+	return{ min, max };
+}
+
+template<RandomAccessIterator I, Function Cost>
+std::pair<I, I> minmax_cost_element_nonempty(I first, I last, Cost cost, std::true_type) {
+	auto r = cost_extrema_nonempty(first, last, cost);
+	return{ r.min, r.max_last };
+}
+
 }
 
+// Vectorized when searching a value of an arithmetic type in an array.
 template<BidirectionalIterator I, typename T>
 I find_backward(I first, I last, const T& val) {
-	return details::find_backward_with_not_found_value(first, last, last, val);
+	return details::find_backward(first, last, val, simd::is_searchable<I, T>());
 }
 
 template<BidirectionalIterator I, UnaryPredicate Pred>
@@ -82,46 +268,104 @@ I find_if_not_backward(I first, I last, Pred pred) {
 	return details::find_if_backward_with_not_found_value(first, last, last, negation(pred));
 }
 
+namespace details {
+
 template<BidirectionalIterator I, typename T>
-requires(first <= hint && hint < last)
-I find(I first, I last, I hint, const T& val) {
+I find(I first, I last, I hint, const T& val, std::false_type) {
 	I lo = hint;
 	I hi = hint + 1;
 	for (;;) {
 		if (*lo == val) return lo;
-		if (hi == last) return details::find_backward_with_not_found_value(first, lo, last, val);
+		if (hi == last) return find_backward_with_not_found_value(first, lo, last, val);
 		if (*hi == val) return hi;
 		++hi;
-		if (lo == first) return find(hi, last, val);
+		if (lo == first) return std::find(hi, last, val);
 		--lo;
 	}
 }
 
-// because of cache misses, it might not be best if the hint is too far from the target
 template<BidirectionalIterator I, UnaryPredicate Pred>
-requires(first <= hint && hint < last)
-I find_if(I first, I last, I hint, Pred pred) {
+I find_if(I first, I last, I hint, Pred pred, std::false_type) {
 	I lo = hint;
 	I hi = hint + 1;
 	for (;;) {
 		if (pred(*lo)) return lo;
-		if (hi == last) return details::find_if_backward_with_not_found_value(first, lo, last, pred);
+		if (hi == last) return find_if_backward_with_not_found_value(first, lo, last, pred);
 		if (pred(*hi)) return hi;
 		++hi;
-		if (lo == first) return find_if(hi, last, pred);
+		if (lo == first) return std::find_if(hi, last, pred);
 		--lo;
 	}
 }
 
+// Expands around the hint by blocks, starting with a cache line and doubling up to 16 lines,
+// prefetching a few lines ahead in both directions.
+// search(f, l) returns l and search_backward(f, l) returns l when they do not find a match.
+// The match nearest to the hint is returned and, at the same distance, the one after the hint,
+// as when expanding element by element.
+template<typename T, typename Search, typename SearchBackward>
+T* find_nearest_by_blocks(T* first, T* last, T* hint, Search search, SearchBackward search_backward) {
+	const std::ptrdiff_t line = sizeof(T) < 64 ? 64 / sizeof(T) : 1;
+	const std::ptrdiff_t ahead = 4 * line;
+	T* lo = hint + 1; // [first, lo) remains to be searched below
+	T* hi = hint + 1; // [hi, last) remains to be searched above
+	for (std::ptrdiff_t k = line; lo != first && hi != last; k = k < 16 * line ? 2 * k : k) {
+		T* lo_block = lo - first > k ? lo - k : first;
+		T* hi_block = last - hi > k ? hi + k : last;
+		simd::prefetch(lo_block - first > ahead ? lo_block - ahead : first);
+		simd::prefetch(last - hi_block > ahead ? hi_block + ahead : hi_block);
+		T* below = search_backward(lo_block, lo);
+		T* above = search(hi, hi_block);
+		if (above != hi_block) {
+			if (below != lo && hint - below < above - hint) return below;
+			return above;
+		}
+		if (below != lo) return below;
+		lo = lo_block;
+		hi = hi_block;
+	}
+	if (hi != last) return search(hi, last);
+	T* below = search_backward(first, lo);
+	return below == lo ? last : below;
+}
+
+template<typename U, typename T>
+U* find(U* first, U* last, U* hint, const T& val, std::true_type) {
+	auto found = find_nearest_by_blocks(static_cast<const T*>(first), static_cast<const T*>(last), static_cast<const T*>(hint),
+		[&](const T* f, const T* l) { return simd::find(f, l, val); },
+		[&](const T* f, const T* l) { return simd::find_backward(f, l, val); });
+	return first + (found - first);
+}
+
+template<typename T, UnaryPredicate Pred>
+T* find_if(T* first, T* last, T* hint, Pred pred, std::true_type) {
+	return find_nearest_by_blocks(first, last, hint,
+		[&](T* f, T* l) { return std::find_if(f, l, pred); },
+		[&](T* f, T* l) { return find_if_backward_with_not_found_value(f, l, l, pred); });
+}
+
+}
+
+// because of cache misses, it might not be best if the hint is too far from the target.
+// On arrays, the search expands by blocks of a cache line, vectorized for the arithmetic types.
+template<BidirectionalIterator I, typename T>
+requires(first <= hint && hint < last)
+I find(I first, I last, I hint, const T& val) {
+	return details::find(first, last, hint, val, simd::is_searchable<I, T>());
+}
+
+// because of cache misses, it might not be best if the hint is too far from the target
+// On arrays, the search expands by blocks of a cache line.
+template<BidirectionalIterator I, UnaryPredicate Pred>
+requires(first <= hint && hint < last)
+I find_if(I first, I last, I hint, Pred pred) {
+	return details::find_if(first, last, hint, pred, std::is_pointer<I>());
+}
 
+// Vectorized when searching a value of an arithmetic type in an array.
 template<InputIterator I, Integer N, typename T>
-std::pair<I, N> find_n(I first, N n, const T& val)
-{ // adapted from EoP
-	while (n && *first != val) {
-		--n;
-		++first;
-	}
-	return{ first, n };
+std::pair<I, N> find_n(I first, N n, const T& val) {
+	return details::find_n(first, n, val, simd::is_searchable<I, T>());
 }
 
 template<InputIterator I, Integer N, UnaryPredicate Pred>
@@ -180,8 +424,10 @@ std::pair<const T&, const T&> adjust_minmax(const T& cmin, const T& cmax, const
 	return{ cmin, cmax };
 }
 
+namespace details {
+
 template <ForwardIterator I>
-std::pair<DifferenceType(I), I> count_while_adjacent(I first, I last)
+std::pair<DifferenceType(I), I> count_while_adjacent(I first, I last, std::false_type)
 {
 	DifferenceType(I) n { 0 };
 	if (first != last) {
@@ -198,12 +444,28 @@ std::pair<DifferenceType(I), I> count_while_adjacent(I first, I last)
 	return{ n, last };
 }
 
+template<typename U>
+std::pair<std::ptrdiff_t, U*> count_while_adjacent(U* first, U* last, std::true_type) {
+	typedef typename std::remove_cv<U>::type T;
+	if (first == last) return{ 0, last };
+	auto n = simd::find_not(static_cast<const T*>(first) + 1, static_cast<const T*>(last), *first) - first;
+	return{ n, first + n };
+}
+
+// True when the runs of an array of I can be written in bulk to an array of pairs (count, value).
+template<typename I, typename O>
+struct is_run_length_encodable : std::false_type {};
+
+template<typename U, typename N, typename T>
+struct is_run_length_encodable<U*, std::pair<N, T>*> : std::integral_constant<bool,
+	simd::is_searchable<U*, T>::value && std::is_integral<N>::value && !std::is_same<N, bool>::value> {};
+
 template<ForwardIterator I, OutputIterator O>
-O unique_copy_with_count(I first, I last, O out) {
+O unique_copy_with_count(I first, I last, O out, std::false_type) {
 	I next;
 	DifferenceType(I) n;
 	while (first != last) {
-		tie(n, next) = count_while_adjacent(first, last);
+		std::tie(n, next) = count_while_adjacent(first, last, simd::is_searchable<I, ValueType(I)>());
 		*out = { n, *first };
 		++out;
 		first = next;
@@ -211,6 +473,28 @@ O unique_copy_with_count(I first, I last, O out) {
 	return out;
 }
 
+template<typename U, typename N, typename T>
+std::pair<N, T>* unique_copy_with_count(U* first, U* last, std::pair<N, T>* out, std::true_type) {
+	return simd::run_length_encode(static_cast<const T*>(first), static_cast<const T*>(last), out);
+}
+
+}
+
+// Vectorized on arrays of an arithmetic type.
+template <ForwardIterator I>
+std::pair<DifferenceType(I), I> count_while_adjacent(I first, I last)
+{
+	return details::count_while_adjacent(first, last, simd::is_searchable<I, ValueType(I)>());
+}
+
+// Writes a pair (count, value) per run of equal elements.
+// When copying an array of an arithmetic type to an array of pairs, the runs are found in bulk,
+// and out must have room for unique_count(first, last) pairs.
+template<ForwardIterator I, OutputIterator O>
+O unique_copy_with_count(I first, I last, O out) {
+	return details::unique_copy_with_count(first, last, out, details::is_run_length_encodable<I, O>());
+}
+
 namespace details {
 
 template<InputIterator I, Integer N, OutputIterator O>
@@ -260,9 +544,32 @@ bool equal_n(I1 f1, I2 f2, N n, Pred pred) {
 	return true;
 }
 
+namespace details {
+
+// True when I1 and I2 are pointers to the same integral or floating point type.
+template<typename I1, typename I2>
+struct are_comparable_arrays : std::false_type {};
+
+template<typename T1, typename T2>
+struct are_comparable_arrays<T1*, T2*> : std::integral_constant<bool,
+	simd::is_searchable<T1*, typename std::remove_cv<T1>::type>::value && std::is_same<typename std::remove_cv<T1>::type, typename std::remove_cv<T2>::type>::value> {};
+
+template<InputIterator I1, InputIterator I2, Integer N>
+bool equal_n(I1 f1, I2 f2, N n, std::false_type) {
+	return xp::equal_n(f1, f2, n, std::equal_to<>());
+}
+
+template<typename T, Integer N>
+bool equal_n(const T* f1, const T* f2, N n, std::true_type) {
+	return simd::mismatch(f1, f1 + n, f2) == f1 + n;
+}
+
+}
+
+// On arrays of integral or floating point values, the elements are compared a vector at a time.
 template<InputIterator I1, InputIterator I2, Integer N>
 bool equal_n(I1 f1, I2 f2, N n) {
-	return equal_n(f1, f2, n, std::equal_to<>());
+	return details::equal_n(f1, f2, n, details::are_comparable_arrays<I1, I2>());
 }
 
 // stable_max is an attempt to render coherent the fact that std::max is unstable.
@@ -306,55 +613,43 @@ I stable_max_element(I first, I last, Compare cmp) {
 
 template<ForwardIterator I>
 I stable_max_element(I first, I last) {
-	return stable_max_element(first, last, std::less<T>());
+	return stable_max_element(first, last, std::less<>());
 }
 
 // The cost function returns a value supporting LessThanComparable
+// On random access ranges, the arithmetic costs are compared by the SIMD kernels.
 template<ForwardIterator I, Function Cost>
 inline
 I min_cost_element(I first, I last, Cost cost) {
 	if (first == last) return last;
-	return details::compare_cost_element_nonempty(first, last, cost, std::less<>());
+	return details::cost_element_nonempty(first, last, cost, std::less<>(), &details::cost_extrema<I>::min, details::has_vectorized_costs<I, Cost>());
 }
 
 // The cost function returns a value supporting LessThanComparable
+// On random access ranges, the arithmetic costs are compared by the SIMD kernels.
 template<ForwardIterator I, Function Cost>
 I max_cost_element(I first, I last, Cost cost) {
 	if (first == last) return last;
-	return details::compare_cost_element_nonempty(first, last, cost, details::transpose<std::less<>>());
+	return details::cost_element_nonempty(first, last, cost, details::transpose<std::less<>>(), &details::cost_extrema<I>::max_first, details::has_vectorized_costs<I, Cost>());
 }
 
 // The cost function returns a value supporting LessThanComparable
+// On random access ranges, the arithmetic costs are compared by the SIMD kernels.
 template<ForwardIterator I, Function Cost>
 I stable_max_cost_element(I first, I last, Cost cost) {
 	if (first == last) return last;
-	return details::compare_cost_element_nonempty(first, last, cost, details::negate<std::less<>>());
+	return details::cost_element_nonempty(first, last, cost, details::negate<std::less<>>(), &details::cost_extrema<I>::max_last, details::has_vectorized_costs<I, Cost>());
 }
 
 // The cost function returns a value supporting LessThanComparable
+// Returns the first minimum and the last maximum, as std::minmax_element.
+// On random access ranges, the arithmetic costs are compared by the SIMD kernels,
+// otherwise they are compared at most 3/2 N times.
 template<ForwardIterator I, Function Cost>
 std::pair<I, I> minmax_cost_element(I first, I last, Cost cost) {
-	using namespace std;
-
 	if (first == last)
 		return{ last, last };
-
-	auto min = first;
-	auto max = first;
-	auto lowest = cost(*first);
-	auto highest = lowest;
-	for (++first; first != last; ++first) {
-		auto val = cost(*first);
-		if (val < lowest) {
-			lowest = val;
-			min = first;
-		}
-		else if (!(val < highest)) {
-			highest = val;
-			max = first;
-		}
-	}
-	return{ min, max };
+	return details::minmax_cost_element_nonempty(first, last, cost, details::has_vectorized_costs<I, Cost>());
 }
 
 template<Range R>
@@ -544,9 +839,96 @@ I find_if_while(I first, Guard guard, Pred pred)
 	return first;
 }
 
+// A guard holding while the iterator is before last, that can tell how many elements remain, so that the *_while algorithms
+// run the elements in blocks instead of calling the guard for each of them. Any guard with a member remaining,
+// returning the count of the elements for which it holds, is such a counted guard.
+// As a relation, it guards the first of the two iterators.
+template<RandomAccessIterator I>
+struct bounded_guard {
+	I last;
+
+	bounded_guard() : last() {}
+	explicit bounded_guard(I last) : last(last) {}
+
+	bool operator()(I i) const { return i != last; }
+	DifferenceType(I) remaining(I i) const { return last - i; }
+
+	template<InputIterator J>
+	bool operator()(I i, J) const { return i != last; }
+	template<InputIterator J>
+	DifferenceType(I) remaining(I i, J) const { return last - i; }
+};
+
+template<RandomAccessIterator I>
+bounded_guard<I> make_bounded_guard(I last) {
+	return bounded_guard<I>(last);
+}
+
+namespace details {
+
+template<typename Guard, typename I, typename = void>
+struct is_counted_guard : std::false_type {};
+
+template<typename Guard, typename I>
+struct is_counted_guard<Guard, I, decltype((void)std::declval<const Guard&>().remaining(std::declval<I>()))> : std::true_type {};
+
+template<typename Guard, typename I1, typename I2, typename = void>
+struct is_counted_relation : std::false_type {};
+
+template<typename Guard, typename I1, typename I2>
+struct is_counted_relation<Guard, I1, I2, decltype((void)std::declval<const Guard&>().remaining(std::declval<I1>(), std::declval<I2>()))> : std::true_type {};
+
+template<typename... I>
+struct are_random_access : std::true_type {};
+
+template<typename I, typename... Is>
+struct are_random_access<I, Is...> : std::integral_constant<bool,
+	std::is_base_of<std::random_access_iterator_tag, typename std::iterator_traits<I>::iterator_category>::value && are_random_access<Is...>::value> {};
+
+// On random access iterators, the n elements run in blocks of 4 then one by one, the count of the loop being known,
+// so that it is unrolled and can be vectorized. The elements are still transformed in order, so op may have a state.
+template<InputIterator I, OutputIterator O, Integer N, UnaryOperation Op>
+O transform_n(I first, N n, O result, Op& op, std::false_type) {
+	for (; n > 0; --n, ++first, ++result)
+		*result = op(*first);
+	return result;
+}
+
+template<RandomAccessIterator I, RandomAccessIterator O, Integer N, UnaryOperation Op>
+O transform_n(I first, N n, O result, Op& op, std::true_type) {
+	for (; n >= 4; n -= 4, first += 4, result += 4) {
+		result[0] = op(first[0]);
+		result[1] = op(first[1]);
+		result[2] = op(first[2]);
+		result[3] = op(first[3]);
+	}
+	for (; n > 0; --n, ++first, ++result)
+		*result = op(*first);
+	return result;
+}
+
+template<InputIterator I1, InputIterator I2, OutputIterator O, Integer N, BinaryOperation Op>
+O transform_n(I1 first1, I2 first2, N n, O result, Op& op, std::false_type) {
+	for (; n > 0; --n, ++first1, ++first2, ++result)
+		*result = op(*first1, *first2);
+	return result;
+}
+
+template<RandomAccessIterator I1, RandomAccessIterator I2, RandomAccessIterator O, Integer N, BinaryOperation Op>
+O transform_n(I1 first1, I2 first2, N n, O result, Op& op, std::true_type) {
+	for (; n >= 4; n -= 4, first1 += 4, first2 += 4, result += 4) {
+		result[0] = op(first1[0], first2[0]);
+		result[1] = op(first1[1], first2[1]);
+		result[2] = op(first1[2], first2[2]);
+		result[3] = op(first1[3], first2[3]);
+	}
+	for (; n > 0; --n, ++first1, ++first2, ++result)
+		*result = op(*first1, *first2);
+	return result;
+}
+
 template<InputIterator I, UnaryPredicate Guard, OutputIterator O, UnaryOperation Op>
-O transform_while(I first, Guard guard, O result, Op op)
-{
+O transform_while(I first, Guard guard, O result, Op& op, std::false_type) {
 	while (guard(first)) {
 		*result = op(*first);
 		++first;
@@ -555,10 +937,13 @@ O transform_while(I first, Guard guard, O result, Op op)
 	return result;
 }
 
-// both iterators are guarded
+template<InputIterator I, UnaryPredicate Guard, OutputIterator O, UnaryOperation Op>
+O transform_while(I first, Guard guard, O result, Op& op, std::true_type) {
+	return transform_n(first, guard.remaining(first), result, op, are_random_access<I, O>());
+}
+
 template<InputIterator I1, UnaryPredicate Guard1, InputIterator I2, UnaryPredicate Guard2, OutputIterator O, BinaryOperation Op>
-O transform_while(I1 first1, Guard1 guard1, I2 first2, Guard1 guard2, O result, Op op)
-{
+O transform_while(I1 first1, Guard1 guard1, I2 first2, Guard2 guard2, O result, Op& op, std::false_type) {
 	while (guard1(first1) && guard2(first2)) {
 		*result = op(*first1, *first2);
 		++first1;
@@ -568,9 +953,16 @@ O transform_while(I1 first1, Guard1 guard1, I2 first2, Guard1 guard2, O result,
 	return result;
 }
 
+template<InputIterator I1, UnaryPredicate Guard1, InputIterator I2, UnaryPredicate Guard2, OutputIterator O, BinaryOperation Op>
+O transform_while(I1 first1, Guard1 guard1, I2 first2, Guard2 guard2, O result, Op& op, std::true_type) {
+	auto n = guard1.remaining(first1);
+	auto n2 = guard2.remaining(first2);
+	if (n2 < n) n = static_cast<decltype(n)>(n2);
+	return transform_n(first1, first2, n, result, op, are_random_access<I1, I2, O>());
+}
+
 template<InputIterator I1, InputIterator I2, Relation Guard, OutputIterator O, BinaryOperation Op>
-O transform_while(I1 first1, I2 first2, Guard guard, O result, Op op)
-{
+O transform_while(I1 first1, I2 first2, Guard guard, O result, Op& op, std::false_type) {
 	while (guard(first1, first2)) {
 		*result = op(*first1, *first2);
 		++first1;
@@ -580,6 +972,34 @@ O transform_while(I1 first1, I2 first2, Guard guard, O result, Op op)
 	return result;
 }
 
+template<InputIterator I1, InputIterator I2, Relation Guard, OutputIterator O, BinaryOperation Op>
+O transform_while(I1 first1, I2 first2, Guard guard, O result, Op& op, std::true_type) {
+	return transform_n(first1, first2, guard.remaining(first1, first2), result, op, are_random_access<I1, I2, O>());
+}
+
+}
+
+// With a counted guard, the elements run in blocks, without calling the guard for each of them.
+template<InputIterator I, UnaryPredicate Guard, OutputIterator O, UnaryOperation Op>
+O transform_while(I first, Guard guard, O result, Op op)
+{
+	return details::transform_while(first, guard, result, op, details::is_counted_guard<Guard, I>());
+}
+
+// both iterators are guarded
+template<InputIterator I1, UnaryPredicate Guard1, InputIterator I2, UnaryPredicate Guard2, OutputIterator O, BinaryOperation Op>
+O transform_while(I1 first1, Guard1 guard1, I2 first2, Guard2 guard2, O result, Op op)
+{
+	return details::transform_while(first1, guard1, first2, guard2, result, op,
+		std::integral_constant<bool, details::is_counted_guard<Guard1, I1>::value && details::is_counted_guard<Guard2, I2>::value>());
+}
+
+template<InputIterator I1, InputIterator I2, Relation Guard, OutputIterator O, BinaryOperation Op>
+O transform_while(I1 first1, I2 first2, Guard guard, O result, Op op)
+{
+	return details::transform_while(first1, first2, guard, result, op, details::is_counted_relation<Guard, I1, I2>());
+}
+
 template<typename T, StrictWeakOrdering Compare>
 const T& min(const T& a, const T& b, const T& c, Compare cmp) {
 	return std::min(a, std::min(b, c, cmp), cmp);
@@ -604,10 +1024,10 @@ const T& max(const T& a, const T& b, const T& c) {
 template<InputIterator I, BinaryOperation Op, Function F>
 auto reduce_nonempty(I first, I last, Op op, F fun) -> decltype(op(*first, *first)) {
 	typedef decltype(op(*first, *first)) T;
-	T r = fn(first);
+	T r = fun(first);
 	++first;
 	while (first != last) {
-		r = op(r, fn(first));
+		r = op(r, fun(first));
 		++first;
 	}
 	return r;
@@ -675,98 +1095,521 @@ T foldl(I first, I last, Op op, const T& z) {
 	return reduce_nonempty(first, last, op);
 }
 
+// The reduce algorithms with an execution policy.
+// The unsequenced policies reduce four contiguous parts of the range at once, to break the
+// dependency on the previous result. The parallel policies split random access ranges
+// in chunks reduced by the thread pool.
+// The partial results are combined in order, so op must be associative but not commutative.
+
 namespace details {
 
-template<InputIterator I, typename T, BinaryOperation Op>
-T foldr_nonempty(I first, I last, Op op, std::input_iterator_tag) {
-	std::stack<std::iterator_traits<I>::value_type> stk;
-	std::copy(first, last, std::back_inserter(stk));
-	auto r = stk.top();
-	stk.pop();
-	while (!stk.empty()) {
-		r = op(stk.top(), r);
-		stk.pop();
+const std::ptrdiff_t parallel_grain = 1 << 14; // the minimal count of elements of a chunk
+
+template<typename I>
+struct dereference {
+	auto operator()(I i) const -> decltype(*i) {
+		return *i;
 	}
-	return r;
+};
+
+template<InputIterator I, BinaryOperation Op, Function F, typename P>
+auto reduce_chunk(I first, I last, Op op, F fun, P, std::input_iterator_tag) -> decltype(op(fun(first), fun(first))) {
+	return reduce_nonempty(first, last, op, fun);
 }
 
-template<BidirectionalIterator I, typename T, BinaryOperation Op>
-T foldr_nonempty(I first, I last, Op op, std::bidirectional_iterator_tag) {
-	return reduce_nonempty(std::reverse_iterator<I>(last), std::reverse_iterator<I>(first), transpose(op));
+template<RandomAccessIterator I, BinaryOperation Op, Function F>
+auto reduce_chunk(I first, I last, Op op, F fun, execution::unsequenced_policy, std::random_access_iterator_tag) -> decltype(op(fun(first), fun(first))) {
+	typedef decltype(op(fun(first), fun(first))) T;
+	auto q = (last - first) / 4;
+	if (q < 2) return reduce_nonempty(first, last, op, fun);
+	I a = first;
+	I b = a + q;
+	I c = b + q;
+	I d = c + q;
+	T ra = fun(a);
+	T rb = fun(b);
+	T rc = fun(c);
+	T rd = fun(d);
+	for (decltype(q) i = 1; i != q; ++i) {
+		ra = op(ra, fun(a + i));
+		rb = op(rb, fun(b + i));
+		rc = op(rc, fun(c + i));
+		rd = op(rd, fun(d + i));
+	}
+	for (I i = d + q; i != last; ++i)
+		rd = op(rd, fun(i));
+	return op(op(ra, rb), op(rc, rd));
 }
 
+template<RandomAccessIterator I, BinaryOperation Op, Function F>
+auto reduce_chunk(I first, I last, Op op, F fun, execution::parallel_unsequenced_policy, std::random_access_iterator_tag) -> decltype(op(fun(first), fun(first))) {
+	return reduce_chunk(first, last, op, fun, execution::unseq, std::random_access_iterator_tag{});
 }
-template<InputIterator I, typename T, BinaryOperation Op>
-T foldr(I first, I last, Op op, const T& z) {
-	if (first == last) return z;
-	return details::foldr_nonempty(first, last, op, std::iterator_traits<I>::iterator_category{});
+
+template<RandomAccessIterator I, BinaryOperation Op, Function F>
+auto reduce_chunk(I first, I last, Op op, F fun, execution::sequenced_policy, std::random_access_iterator_tag) -> decltype(op(fun(first), fun(first))) {
+	return reduce_nonempty(first, last, op, fun);
 }
 
-template<BidirectionalIterator I, OutputIterator O, UnaryOperation Op>
-O transform_backward(I first, I last, O result, Op op) {
-	while (first != last)
-		*--result = op(*--last);
-	return result;
+template<RandomAccessIterator I, BinaryOperation Op, Function F>
+auto reduce_chunk(I first, I last, Op op, F fun, execution::parallel_policy, std::random_access_iterator_tag) -> decltype(op(fun(first), fun(first))) {
+	return reduce_nonempty(first, last, op, fun);
 }
 
-template<BidirectionalIterator I1, BidirectionalIterator I2, OutputIterator O, UnaryOperation Op>
-O transform_backward(I1 first1, I1 last1, I2 last2, O result, Op op) {
-	while (first1 != last1)
-		*--result = op(*--last1, *--last2);
-	return result;
+// Calls reduce(f, l) on the chunks of [first, last) and returns the results, in order.
+// The results must be default constructible.
+template<RandomAccessIterator I, Function R>
+auto reduce_chunks(I first, I last, R reduce) -> std::vector<decltype(reduce(first, last))> {
+	auto n = last - first;
+	auto& pool = thread_pool::global();
+	auto chunks = std::min<std::ptrdiff_t>(n / parallel_grain, 4 * (pool.size() + 1));
+	if (chunks < 1) chunks = 1;
+	std::vector<decltype(reduce(first, last))> results(chunks);
+	pool.for_each_index(chunks, [&](std::size_t k) {
+		auto i = static_cast<std::ptrdiff_t>(k);
+		results[k] = reduce(first + n * i / chunks, first + n * (i + 1) / chunks);
+	});
+	return results;
 }
 
-// slide selection to another position.
-// ...****......
-//          ^
-// .....****....
-// from sean parent
-template<RandomAccessIterator I>
-std::pair<I, I> slide(I first, I last, I point) {
-	using namespace std;
+template<InputIterator I, BinaryOperation Op, Function F, typename P>
+auto reduce_nonempty_with_policy(P policy, I first, I last, Op op, F fun, std::false_type) -> decltype(op(fun(first), fun(first))) {
+	return reduce_chunk(first, last, op, fun, policy, typename std::iterator_traits<I>::iterator_category{});
+}
 
-	if (point < first) return { point, rotate(point, first, last) };
-	if (last < point) return { rotate(first, last, point), point };
-	return{ first, last };
+template<RandomAccessIterator I, BinaryOperation Op, Function F, typename P>
+auto reduce_nonempty_with_policy(P policy, I first, I last, Op op, F fun, std::true_type) -> decltype(op(fun(first), fun(first))) {
+	if (last - first < 2 * parallel_grain)
+		return reduce_chunk(first, last, op, fun, policy, std::random_access_iterator_tag{});
+	auto partials = reduce_chunks(first, last, [&](I f, I l) {
+		return reduce_chunk(f, l, op, fun, policy, std::random_access_iterator_tag{});
+	});
+	return reduce_nonempty(partials.begin(), partials.end(), op);
 }
 
-// gather selected elements around a position.
-// ..**.*....*...
-//        ^
-// ....****......
-// from sean parent
-template<BidirectionalIterator I, UnaryPredicate P>
-std::pair<I, I> gather(I first, I last, I point, P pred) {
-	using namespace std;
+template<InputIterator I, typename T, BinaryOperation Op, Function F, typename P>
+T reduce_nonzeroes_with_policy(P, I first, I last, Op op, F fun, const T& z, std::false_type) {
+	return reduce_nonzeroes(first, last, op, fun, z);
+}
 
-	return{ stable_partition(first, point, not1(pred)), stable_partition(point, last, pred) };
+template<RandomAccessIterator I, typename T, BinaryOperation Op, Function F, typename P>
+T reduce_nonzeroes_with_policy(P, I first, I last, Op op, F fun, const T& z, std::true_type) {
+	if (last - first < 2 * parallel_grain)
+		return reduce_nonzeroes(first, last, op, fun, z);
+	auto partials = reduce_chunks(first, last, [&](I f, I l) {
+		return reduce_nonzeroes(f, l, op, fun, z);
+	});
+	return reduce_nonzeroes(partials.begin(), partials.end(), op, z);
 }
 
-// from sean parent <https://youtu.be/giNtMitSdfQ?t=3688>
-// remarks (VJA 20160701): 
-// - could be optimized by implementing a reverse_n (why counting everytime?)
+template<typename P, typename I>
+struct runs_in_parallel : std::integral_constant<bool, execution::is_parallel<P>::value
+	&& std::is_base_of<std::random_access_iterator_tag, typename std::iterator_traits<I>::iterator_category>::value> {};
 
-template<ForwardIterator I, Integer N>
-I reverse_n_forward(I f, N n) {
-	if (n < 2) return f + n;
-	N h = n / 2;
-	I m = reverse_n_forward(f, h);
-	I l = std::swap_ranges(f, m, m + n % 2);
-	reverse_n_forward(f, h);
-	return l;
 }
 
-template<ForwardIterator I>
-void reverse_forward(I f, I l) {
-	auto n = distance(f, l);
-	reverse_n_forward(f, n);
+template<typename P, InputIterator I, BinaryOperation Op, Function F>
+auto reduce_nonempty(P policy, I first, I last, Op op, F fun)
+-> typename std::enable_if<execution::is_execution_policy<P>::value, decltype(op(fun(first), fun(first)))>::type {
+	return details::reduce_nonempty_with_policy(policy, first, last, op, fun, details::runs_in_parallel<P, I>());
 }
 
-template <InputIterator I1, InputIterator I2, Relation Pred>
-auto hamming_distance(I1 first1, I1 last1, I2 first2, Pred pred) -> typename std::iterator_traits<I1>::difference_type {
+template<typename P, InputIterator I, BinaryOperation Op>
+auto reduce_nonempty(P policy, I first, I last, Op op)
+-> typename std::enable_if<execution::is_execution_policy<P>::value, decltype(op(*first, *first))>::type {
+	return details::reduce_nonempty_with_policy(policy, first, last, op, details::dereference<I>(), details::runs_in_parallel<P, I>());
+}
+
+template<typename P, InputIterator I, typename T, BinaryOperation Op, Function F>
+typename std::enable_if<execution::is_execution_policy<P>::value, T>::type reduce(P policy, I first, I last, Op op, F fun, const T& z) {
+	if (first == last) return z;
+	return reduce_nonempty(policy, first, last, op, fun);
+}
+
+template<typename P, InputIterator I, typename T, BinaryOperation Op>
+typename std::enable_if<execution::is_execution_policy<P>::value, T>::type reduce(P policy, I first, I last, Op op, const T& z) {
+	if (first == last) return z;
+	return reduce_nonempty(policy, first, last, op);
+}
+
+template<typename P, InputIterator I, typename T, BinaryOperation Op, Function F>
+typename std::enable_if<execution::is_execution_policy<P>::value, T>::type reduce_nonzeroes(P policy, I first, I last, Op op, F fun, const T& z) {
+	return details::reduce_nonzeroes_with_policy(policy, first, last, op, fun, z, details::runs_in_parallel<P, I>());
+}
+
+template<typename P, InputIterator I, typename T, BinaryOperation Op>
+typename std::enable_if<execution::is_execution_policy<P>::value, T>::type reduce_nonzeroes(P policy, I first, I last, Op op, const T& z) {
+	return details::reduce_nonzeroes_with_policy(policy, first, last, op, details::dereference<I>(), z, details::runs_in_parallel<P, I>());
+}
+
+// requires op to be associative, unless the policy is sequenced.
+template<typename P, InputIterator I, typename T, BinaryOperation Op>
+typename std::enable_if<execution::is_execution_policy<P>::value, T>::type foldl(P policy, I first, I last, Op op, const T& z) {
+	if (first == last) return z;
+	return reduce_nonempty(policy, first, last, op);
+}
+
+namespace details {
+
+// the elements are read once, so they are all kept in memory.
+template<InputIterator I, BinaryOperation Op>
+ValueType(I) foldr_input_nonempty(I first, I last, Op op) {
+	typedef ValueType(I) T;
+	std::vector<T> elements(first, last);
+	T r = std::move(elements.back());
+	elements.pop_back();
+	while (!elements.empty()) {
+		r = op(elements.back(), r);
+		elements.pop_back();
+	}
+	return r;
+}
+
+template<InputIterator I, typename T, BinaryOperation Op>
+T foldr_nonempty(I first, I last, Op op, std::input_iterator_tag) {
+	return foldr_input_nonempty(first, last, op);
+}
+
+template<BidirectionalIterator I, typename T, BinaryOperation Op>
+T foldr_nonempty(I first, I last, Op op, std::bidirectional_iterator_tag) {
+	return reduce_nonempty(std::reverse_iterator<I>(last), std::reverse_iterator<I>(first), xp::transpose(op));
+}
+
+}
+// On input iterators, the elements are kept in memory. foldr of out_of_core.h bounds it.
+template<InputIterator I, typename T, BinaryOperation Op>
+T foldr(I first, I last, Op op, const T& z) {
+	if (first == last) return z;
+	return details::foldr_nonempty<I, T>(first, last, op, typename std::iterator_traits<I>::iterator_category{});
+}
+
+namespace details {
+
+template<BidirectionalIterator I, OutputIterator O, UnaryOperation Op>
+O transform_backward(I first, I last, O result, Op& op, std::false_type) {
+	while (first != last)
+		*--result = op(*--last);
+	return result;
+}
+
+// in blocks of 4, as transform_n, indexed from the first elements so that the compiler sees the accesses as a linear sequence.
+template<RandomAccessIterator I, RandomAccessIterator O, UnaryOperation Op>
+O transform_backward(I first, I last, O result, Op& op, std::true_type) {
+	auto i = last - first;
+	result -= i;
+	for (; i >= 4; i -= 4) {
+		result[i - 1] = op(first[i - 1]);
+		result[i - 2] = op(first[i - 2]);
+		result[i - 3] = op(first[i - 3]);
+		result[i - 4] = op(first[i - 4]);
+	}
+	for (; i > 0; --i)
+		result[i - 1] = op(first[i - 1]);
+	return result;
+}
+
+template<BidirectionalIterator I1, BidirectionalIterator I2, OutputIterator O, BinaryOperation Op>
+O transform_backward(I1 first1, I1 last1, I2 last2, O result, Op& op, std::false_type) {
+	while (first1 != last1)
+		*--result = op(*--last1, *--last2);
+	return result;
+}
+
+template<RandomAccessIterator I1, RandomAccessIterator I2, RandomAccessIterator O, BinaryOperation Op>
+O transform_backward(I1 first1, I1 last1, I2 last2, O result, Op& op, std::true_type) {
+	auto i = last1 - first1;
+	auto first2 = last2 - i;
+	result -= i;
+	for (; i >= 4; i -= 4) {
+		result[i - 1] = op(first1[i - 1], first2[i - 1]);
+		result[i - 2] = op(first1[i - 2], first2[i - 2]);
+		result[i - 3] = op(first1[i - 3], first2[i - 3]);
+		result[i - 4] = op(first1[i - 4], first2[i - 4]);
+	}
+	for (; i > 0; --i)
+		result[i - 1] = op(first1[i - 1], first2[i - 1]);
+	return result;
+}
+
+}
+
+// The elements are transformed from the last one. The result may overlap the input when it ends after it.
+template<BidirectionalIterator I, OutputIterator O, UnaryOperation Op>
+O transform_backward(I first, I last, O result, Op op) {
+	return details::transform_backward(first, last, result, op, details::are_random_access<I, O>());
+}
+
+template<BidirectionalIterator I1, BidirectionalIterator I2, OutputIterator O, BinaryOperation Op>
+O transform_backward(I1 first1, I1 last1, I2 last2, O result, Op op) {
+	return details::transform_backward(first1, last1, last2, result, op, details::are_random_access<I1, I2, O>());
+}
+
+namespace details {
+
+const std::size_t rotate_buffer_bytes = 1 << 20; // the most allocated by slide on arrays
+
+// True when I is a pointer to mutable values that can be copied with memmove.
+template<typename I>
+struct is_memmovable : std::false_type {};
+
+template<typename T>
+struct is_memmovable<T*> : std::integral_constant<bool, !std::is_const<T>::value && std::is_trivially_copyable<T>::value> {};
+
+// swaps the disjoint ranges [a, a + n) and [b, b + n) through the buffer, a block at a time.
+template<typename T>
+void swap_blocks(T* a, T* b, std::size_t n, T* buffer, std::size_t capacity) {
+	while (n != 0) {
+		auto k = std::min(n, capacity);
+		std::memcpy(buffer, a, k * sizeof(T));
+		std::memcpy(a, b, k * sizeof(T));
+		std::memcpy(b, buffer, k * sizeof(T));
+		a += k;
+		b += k;
+		n -= k;
+	}
+}
+
+// Gries and Mills' block swap, until the shorter side fits in the buffer. When the left side is the shorter,
+// it is swapped with the start of the right side, whose first block is then in place, and the rotation goes on
+// to the right of it. When the right side is the shorter, it is swapped with the end of the left side, where it
+// belongs, and the rotation goes on to the left of it. Then the shorter side is copied to the buffer, the longer
+// side is moved with memmove, and the buffer is copied back, so each element is copied about twice.
+template<typename T>
+T* rotate_with_buffer(T* first, T* middle, T* last, T* buffer, std::size_t capacity) {
+	T* r = first + (last - middle);
+	for (;;) {
+		auto left = static_cast<std::size_t>(middle - first);
+		auto right = static_cast<std::size_t>(last - middle);
+		if (left == 0 || right == 0) return r;
+		if (left <= right && left <= capacity) {
+			std::memcpy(buffer, first, left * sizeof(T));
+			std::memmove(first, middle, right * sizeof(T));
+			std::memcpy(first + right, buffer, left * sizeof(T));
+			return r;
+		}
+		if (right < left && right <= capacity) {
+			std::memcpy(buffer, middle, right * sizeof(T));
+			std::memmove(first + right, first, left * sizeof(T));
+			std::memcpy(first, buffer, right * sizeof(T));
+			return r;
+		}
+		if (left <= right) {
+			swap_blocks(first, middle, left, buffer, capacity);
+			first = middle;
+			middle += left;
+		}
+		else {
+			swap_blocks(middle - right, middle, right, buffer, capacity);
+			last = middle;
+			middle -= right;
+		}
+	}
+}
+
+template<RandomAccessIterator I>
+I rotate(I first, I middle, I last, std::false_type) {
+	return std::rotate(first, middle, last);
+}
+
+template<typename T>
+T* rotate(T* first, T* middle, T* last, std::true_type) {
+	auto shorter = static_cast<std::size_t>(std::min(middle - first, last - middle));
+	auto capacity = std::min(shorter, std::max<std::size_t>(1, rotate_buffer_bytes / sizeof(T)));
+	if (capacity == 0) return first + (last - middle);
+	std::unique_ptr<unsigned char[]> buffer(new (std::nothrow) unsigned char[capacity * sizeof(T)]);
+	if (!buffer) return std::rotate(first, middle, last);
+	return rotate_with_buffer(first, middle, last, reinterpret_cast<T*>(buffer.get()), capacity);
+}
+
+}
+
+// slide selection to another position.
+// ...****......
+//          ^
+// .....****....
+// from sean parent
+// On arrays of trivially copyable values, the elements are moved with memmove, through a buffer of at most rotate_buffer_bytes.
+template<RandomAccessIterator I>
+std::pair<I, I> slide(I first, I last, I point) {
+	if (point < first) return { point, details::rotate(point, first, last, details::is_memmovable<I>()) };
+	if (last < point) return { details::rotate(first, last, point, details::is_memmovable<I>()), point };
+	return{ first, last };
+}
+
+// The range of the gathered elements, and the count of the elements moved to gather them.
+template<BidirectionalIterator I>
+struct gather_result : std::pair<I, I> {
+	std::size_t moved;
+
+	gather_result(I first, I last, std::size_t moved) : std::pair<I, I>(first, last), moved(moved) {}
+};
+
+namespace details {
+
+// Moves the elements of [first, last) satisfying pred after the other ones, keeping the order of both, and returns the first of them.
+// In a single pass, the runs of other elements are moved down and the selected elements are moved to the buffer, then after the runs.
+// The elements before the first selected one and the selected ones at the end are not moved, the others are, and are counted in moved.
+template<BidirectionalIterator I, UnaryPredicate P, typename B>
+I gather_back(I first, I last, P pred, B& buffer, std::size_t& moved) {
+	first = std::find_if(first, last, pred);
+	while (last != first && pred(*std::prev(last)))
+		--last;
+	if (first == last) return first;
+
+	moved += static_cast<std::size_t>(std::distance(first, last));
+	buffer.clear();
+	I out = first;
+	while (first != last) {
+		buffer.push_back(std::move(*first));
+		I next = std::find_if(++first, last, pred);
+		out = std::move(first, next, out);
+		first = next;
+	}
+	std::move(buffer.begin(), buffer.end(), out);
+	return out;
+}
+
+// Moves the elements of [first, last) satisfying pred before the other ones, keeping the order of both, and returns the end of them.
+// The mirror of gather_back, the runs of other elements being moved up from the end.
+template<BidirectionalIterator I, UnaryPredicate P, typename B>
+I gather_front(I first, I last, P pred, B& buffer, std::size_t& moved) {
+	while (first != last && pred(*first))
+		++first;
+	while (last != first && !pred(*std::prev(last)))
+		--last;
+	if (first == last) return first;
+
+	moved += static_cast<std::size_t>(std::distance(first, last));
+	buffer.clear();
+	I out = last;
+	while (last != first) {
+		buffer.push_back(std::move(*--last));
+		I next = last;
+		while (next != first && !pred(*std::prev(next)))
+			--next;
+		out = std::move_backward(next, last, out);
+		last = next;
+	}
+	std::move(buffer.rbegin(), buffer.rend(), first);
+	return out;
+}
+
+}
+
+// gather selected elements around a position.
+// ..**.*....*...
+//        ^
+// ....****......
+// from sean parent
+// Each side is gathered in a single pass, the selected elements being moved through a buffer.
+// On arrays of trivially copyable values, the runs of other elements are moved with memmove.
+template<BidirectionalIterator I, UnaryPredicate P>
+gather_result<I> gather(I first, I last, I point, P pred) {
+	std::vector<ValueType(I)> buffer;
+	std::size_t moved = 0;
+	I lower = details::gather_back(first, point, pred, buffer, moved);
+	I upper = details::gather_front(point, last, pred, buffer, moved);
+	return{ lower, upper, moved };
+}
+
+// from sean parent <https://youtu.be/giNtMitSdfQ?t=3688>
+// remarks (VJA 20160701): 
+// - could be optimized by implementing a reverse_n (why counting everytime?)
+// O(n log n) swaps, with a recursion depth of log n. reverse_n uses it when no buffer can be allocated.
+
+template<ForwardIterator I, Integer N>
+I reverse_n_forward(I f, N n) {
+	if (n < 2) return std::next(f, n);
+	N h = n / 2;
+	I m = reverse_n_forward(f, h);
+	I l = std::swap_ranges(f, m, std::next(m, n % 2));
+	reverse_n_forward(f, h);
+	return l;
+}
+
+namespace details {
+
+const std::size_t reverse_buffer_bytes = 1 << 20; // the most allocated by reverse_n on forward iterators
+
+// adapted from EoP's reverse_n_adaptive: the ranges fitting in the buffer are reversed through it in linear time,
+// so the cost is O(n log(n / b)) for a buffer of b elements, and O(n) when the whole range fits.
+template<ForwardIterator I, Integer N, typename B>
+I reverse_n_with_buffer(I f, N n, B& buffer) {
+	if (n < 2) return std::next(f, n);
+	if (static_cast<std::size_t>(n) <= buffer.capacity()) {
+		I l = f;
+		for (N i = 0; i != n; ++i, ++l)
+			buffer.push_back(std::move(*l));
+		for (; !buffer.empty(); ++f) {
+			*f = std::move(buffer.back());
+			buffer.pop_back();
+		}
+		return l;
+	}
+	N h = n / 2;
+	I m = reverse_n_with_buffer(f, h, buffer);
+	I l = std::swap_ranges(f, m, std::next(m, n % 2));
+	reverse_n_with_buffer(f, h, buffer);
+	return l;
+}
+
+template<ForwardIterator I, Integer N>
+I reverse_n(I f, N n, std::forward_iterator_tag) {
+	typedef ValueType(I) T;
+	std::vector<T> buffer;
+	try {
+		buffer.reserve(std::min(static_cast<std::size_t>(n), std::max<std::size_t>(1, reverse_buffer_bytes / sizeof(T))));
+	}
+	catch (const std::bad_alloc&) {
+		return reverse_n_forward(f, n);
+	}
+	return reverse_n_with_buffer(f, n, buffer);
+}
+
+template<BidirectionalIterator I, Integer N>
+I reverse_n(I f, N n, std::bidirectional_iterator_tag) {
+	I l = std::next(f, n);
+	std::reverse(f, l);
+	return l;
+}
+
+template<ForwardIterator I, Integer N>
+I reverse_n(I f, N n, std::false_type) {
+	return reverse_n(f, n, typename std::iterator_traits<I>::iterator_category());
+}
+
+template<typename T, Integer N>
+T* reverse_n(T* f, N n, std::true_type) {
+	simd::reverse(f, f + n);
+	return f + n;
+}
+
+template<typename I>
+struct is_byte_reversible : std::false_type {};
+
+template<typename T>
+struct is_byte_reversible<T*> : std::integral_constant<bool, !std::is_const<T>::value && simd::is_byte_reversible<T>::value> {};
+
+}
+
+// Reverses the n elements at f and returns their end, counting them once.
+// On forward iterators, the elements are moved through a bounded buffer, in linear time when they fit.
+// On arrays of trivially copyable values, the bytes are shuffled a vector at a time.
+template<ForwardIterator I, Integer N>
+I reverse_n(I f, N n) {
+	return details::reverse_n(f, n, details::is_byte_reversible<I>());
+}
+
+template<ForwardIterator I>
+void reverse_forward(I f, I l) {
+	reverse_n(f, std::distance(f, l));
+}
+
+template <InputIterator I1, InputIterator I2, Relation Pred>
+auto hamming_distance(I1 first1, I1 last1, I2 first2, Pred pred) -> typename std::iterator_traits<I1>::difference_type {
 	using namespace std;
 
-	typename iterator_traits<I>::difference_type result{};
+	typename iterator_traits<I1>::difference_type result{};
 	while (first1 != last1) {
 		if (!pred(*first1, *first2))
 			++result;
@@ -776,14 +1619,6 @@ auto hamming_distance(I1 first1, I1 last1, I2 first2, Pred pred) -> typename std
 	return result;
 }
 
-template <InputIterator I1, InputIterator I2>
-auto hamming_distance(I1 first1, I1 last1, I2 first2)
--> typename std::iterator_traits<I1>::difference_type {
-	typedef typename std::iterator_traits<I>::value_type value_type;
-
-	return hamming_distance(first1, last1, first2, std::equal<value_type>());
-}
-
 template <InputIterator I1, InputIterator I2, Integer N, Relation Pred>
 N hamming_distance_n(I1 first1, N n, I2 first2, Pred pred) {
 	N result = 0;
@@ -796,11 +1631,116 @@ N hamming_distance_n(I1 first1, N n, I2 first2, Pred pred) {
 	return result;
 }
 
+namespace details {
+
+template <InputIterator I1, InputIterator I2>
+auto hamming_distance(I1 first1, I1 last1, I2 first2, std::false_type) -> typename std::iterator_traits<I1>::difference_type {
+	return xp::hamming_distance(first1, last1, first2, std::equal_to<>());
+}
+
+template<typename T>
+std::ptrdiff_t hamming_distance(const T* first1, const T* last1, const T* first2, std::true_type) {
+	return static_cast<std::ptrdiff_t>(simd::count_mismatches(first1, last1, first2));
+}
+
+template <InputIterator I1, InputIterator I2, Integer N>
+N hamming_distance_n(I1 first1, N n, I2 first2, std::false_type) {
+	return xp::hamming_distance_n(first1, n, first2, std::equal_to<>());
+}
+
+template<typename T, Integer N>
+N hamming_distance_n(const T* first1, N n, const T* first2, std::true_type) {
+	return N(simd::count_mismatches(first1, first1 + n, first2));
+}
+
+}
+
+// On arrays of integral or floating point values, the elements are compared a vector at a time.
+template <InputIterator I1, InputIterator I2>
+auto hamming_distance(I1 first1, I1 last1, I2 first2)
+-> typename std::iterator_traits<I1>::difference_type {
+	return details::hamming_distance(first1, last1, first2, details::are_comparable_arrays<I1, I2>());
+}
+
 template <InputIterator I1, InputIterator I2, Integer N>
 N hamming_distance_n(I1 first1, N n, I2 first2) {
-	typedef typename std::iterator_traits<I>::value_type value_type;
+	return details::hamming_distance_n(first1, n, first2, details::are_comparable_arrays<I1, I2>());
+}
+
+namespace details {
+
+typedef std::pair<std::size_t, std::size_t> code_neighbor; // the distance and the index of a code
+
+// Keeps the k nearest of the codes [first, last) in a heap, the farthest one on top. The distances are computed a block at a time,
+// most codes being farther than the top of the heap once it is full, so that the heap is rarely updated.
+// Equally distant codes are kept by increasing index, so the result does not depend on how the codes are split.
+inline void nearest_codes(const std::uint8_t* query, const std::uint8_t* codes, std::size_t first, std::size_t last, std::size_t bytes, std::size_t k, std::vector<code_neighbor>& heap) {
+	const std::size_t block = 1024;
+	std::uint32_t distances[block];
+	for (auto i = first; i < last && k != 0; i += block) {
+		auto m = std::min(block, last - i);
+		simd::bit_distances(query, codes + i * bytes, m, bytes, distances);
+		for (std::size_t j = 0; j != m; ++j) {
+			code_neighbor x(distances[j], i + j);
+			if (heap.size() < k) {
+				heap.push_back(x);
+				std::push_heap(heap.begin(), heap.end());
+			}
+			else if (x < heap.front()) {
+				std::pop_heap(heap.begin(), heap.end());
+				heap.back() = x;
+				std::push_heap(heap.begin(), heap.end());
+			}
+		}
+	}
+}
+
+}
+
+// Writes the k codes nearest to the query, as pairs of their bit distance and their index, by increasing distance,
+// the equally distant ones by increasing index. The n codes are laid out contiguously at codes, all of the size of the query.
+// Returns the end of the pairs written, min(k, n) of them.
+template<OutputIterator O>
+O nearest_codes(const std::uint8_t* query, const std::uint8_t* codes, std::size_t n, std::size_t bytes, std::size_t k, O out) {
+	std::vector<details::code_neighbor> heap;
+	heap.reserve(std::min(k, n));
+	details::nearest_codes(query, codes, 0, n, bytes, k, heap);
+	std::sort_heap(heap.begin(), heap.end());
+	return std::copy(heap.begin(), heap.end(), out);
+}
+
+namespace details {
+
+template<typename P, OutputIterator O>
+O nearest_codes_with_policy(P, const std::uint8_t* query, const std::uint8_t* codes, std::size_t n, std::size_t bytes, std::size_t k, O out, std::false_type) {
+	return xp::nearest_codes(query, codes, n, bytes, k, out);
+}
+
+// The k nearest codes of each chunk are found in parallel, then merged.
+template<typename P, OutputIterator O>
+O nearest_codes_with_policy(P, const std::uint8_t* query, const std::uint8_t* codes, std::size_t n, std::size_t bytes, std::size_t k, O out, std::true_type) {
+	auto& pool = thread_pool::global();
+	auto chunks = std::min<std::size_t>(n / parallel_grain, 4 * (pool.size() + 1));
+	if (chunks < 2)
+		return xp::nearest_codes(query, codes, n, bytes, k, out);
+
+	std::vector<std::vector<code_neighbor>> heaps(chunks);
+	pool.for_each_index(chunks, [&](std::size_t c) {
+		nearest_codes(query, codes, n * c / chunks, n * (c + 1) / chunks, bytes, k, heaps[c]);
+	});
+	std::vector<code_neighbor> r;
+	for (auto& h : heaps)
+		r.insert(r.end(), h.begin(), h.end());
+	auto m = std::min(k, r.size());
+	std::partial_sort(r.begin(), r.begin() + m, r.end());
+	return std::copy(r.begin(), r.begin() + m, out);
+}
+
+}
 
-	return hamming_distance_n(first1, last1, first2, std::equal<value_type>());
+template<typename P, OutputIterator O>
+typename std::enable_if<execution::is_execution_policy<P>::value, O>::type nearest_codes(P policy, const std::uint8_t* query, const std::uint8_t* codes, std::size_t n, std::size_t bytes, std::size_t k, O out) {
+	return details::nearest_codes_with_policy(policy, query, codes, n, bytes, k, out, details::runs_in_parallel<P, const std::uint8_t*>());
 }
 
 namespace details {
@@ -850,13 +1790,30 @@ auto unique_count(I first, I last, R rel)-> typename std::iterator_traits<I>::di
 	return details::unique_count(first, last, rel, std::iterator_traits<I>::iterator_category());
 }
 
+namespace details {
+
 template <ForwardIterator I>
-auto unique_count(I first, I last)-> typename std::iterator_traits<I>::difference_type
+auto unique_count(I first, I last, std::false_type)-> typename std::iterator_traits<I>::difference_type
 {
 	using namespace std;
 
 	typedef typename iterator_traits<I>::value_type value_type;
-	return details::unique_count(first, last, equal_to<value_type>(), iterator_traits<I>::iterator_category());
+	return details::unique_count(first, last, equal_to<value_type>(), typename iterator_traits<I>::iterator_category());
+}
+
+template<typename U>
+std::ptrdiff_t unique_count(U* first, U* last, std::true_type) {
+	typedef typename std::remove_cv<U>::type T;
+	return static_cast<std::ptrdiff_t>(simd::count_runs(static_cast<const T*>(first), static_cast<const T*>(last)));
+}
+
+}
+
+// Vectorized on arrays of an arithmetic type, counting the differences between adjacent elements without branches.
+template <ForwardIterator I>
+auto unique_count(I first, I last)-> typename std::iterator_traits<I>::difference_type
+{
+	return details::unique_count(first, last, simd::is_searchable<I, ValueType(I)>());
 }
 
 // from Alexander Stepanov's Efficient Programming with Components
@@ -928,6 +1885,164 @@ public:
 	}
 };
 
+namespace details {
+
+// Reduces the 2^k elements starting at first as a binary counter would, the earlier elements on the left.
+template <typename T, InputIterator I, BinaryOperation Op>
+T reduce_balanced_block(I& first, unsigned k, Op op) {
+	if (k == 0) {
+		T x = *first;
+		++first;
+		return x;
+	}
+	T x = reduce_balanced_block<T>(first, k - 1, op);
+	T y = reduce_balanced_block<T>(first, k - 1, op);
+	return op(x, y);
+}
+
+}
+
+// A binary_counter of fixed capacity, which never allocates.
+// N levels hold the reduction of up to 2^N - 1 elements.
+template <typename T, BinaryOperation Op, std::size_t N = 64>
+class fixed_binary_counter
+{
+private:
+	std::array<T, N> counter;
+	std::size_t size;
+	Op op;
+	T zero;
+
+	// the largest block reduced at once by add_range, 2^max_block elements.
+	static const unsigned max_block = 10;
+
+	void add_at(std::size_t level, T x) {
+		for (; size < level; ++size)
+			counter[size] = zero;
+		x = add_to_counter(counter.begin() + level, counter.begin() + size, op, zero, x);
+		if (x != zero) {
+			if (size == N) throw std::overflow_error("fixed_binary_counter is full.");
+			counter[size++] = x;
+		}
+	}
+
+public:
+	fixed_binary_counter(const Op& op, const T& zero) : size(0), op(op), zero(zero) {}
+
+	void add(T x) {
+		add_at(0, x);
+	}
+
+	// Same result as adding the elements one by one, but when the lower levels are empty, the
+	// elements are reduced by blocks of 2^k, that stay in cache, before being added to the level k.
+	template<InputIterator I>
+	void add_range(I first, I last) {
+		add_range(first, last, typename std::iterator_traits<I>::iterator_category{});
+	}
+
+	// reduce
+	// returns: value of the counter
+	T reduce() const {
+		return reduce_counter(counter.begin(), counter.begin() + size, op, zero);
+	}
+
+private:
+	template<InputIterator I>
+	void add_range(I first, I last, std::input_iterator_tag) {
+		for (; first != last; ++first)
+			add_at(0, *first);
+	}
+
+	template<RandomAccessIterator I>
+	void add_range(I first, I last, std::random_access_iterator_tag) {
+		while (first != last) {
+			unsigned k = 0;
+			while (k < max_block && (k >= size || counter[k] == zero))
+				++k;
+			while ((DifferenceType(I)(1) << k) > last - first)
+				--k;
+			add_at(k, details::reduce_balanced_block<T>(first, k, op));
+		}
+	}
+};
+
+// A binary counter per worker, to reduce from several threads.
+// The worker i must add its elements to local(i), and the elements of the worker i
+// are considered before the elements of the worker i + 1 by reduce.
+template <typename T, BinaryOperation Op, std::size_t N = 64>
+class concurrent_binary_counter
+{
+private:
+	struct slot {
+		fixed_binary_counter<T, Op, N> counter;
+		char padding[64]; // avoid false sharing with the next slot
+		slot(const Op& op, const T& zero) : counter(op, zero) {}
+	};
+
+	std::vector<slot> slots;
+	Op op;
+	T zero;
+
+public:
+	concurrent_binary_counter(const Op& op, const T& zero, std::size_t workers) : op(op), zero(zero) {
+		slots.reserve(workers);
+		for (std::size_t i = 0; i != workers; ++i)
+			slots.emplace_back(op, zero);
+	}
+
+	std::size_t workers() const {
+		return slots.size();
+	}
+
+	fixed_binary_counter<T, Op, N>& local(std::size_t worker) {
+		return slots[worker].counter;
+	}
+
+	// must not be called while the workers are adding.
+	T reduce() const {
+		fixed_binary_counter<T, Op, N> merged(op, zero);
+		for (auto& s : slots) {
+			T x = s.counter.reduce();
+			if (x != zero) merged.add(x);
+		}
+		return merged.reduce();
+	}
+};
+
+namespace details {
+
+template<InputIterator I, typename T, BinaryOperation Op>
+T reduce_balanced(I first, I last, Op op, const T& zero, std::false_type) {
+	fixed_binary_counter<T, Op> counter(op, zero);
+	counter.add_range(first, last);
+	return counter.reduce();
+}
+
+template<RandomAccessIterator I, typename T, BinaryOperation Op>
+T reduce_balanced(I first, I last, Op op, const T& zero, std::true_type) {
+	auto n = last - first;
+	if (n < 2 * parallel_grain)
+		return reduce_balanced(first, last, op, zero, std::false_type{});
+	auto& pool = thread_pool::global();
+	auto chunks = std::min<decltype(n)>(n / parallel_grain, pool.size() + 1);
+	concurrent_binary_counter<T, Op> counter(op, zero, chunks);
+	pool.for_each_index(chunks, [&](std::size_t k) {
+		auto i = static_cast<decltype(n)>(k);
+		counter.local(k).add_range(first + n * i / chunks, first + n * (i + 1) / chunks);
+	});
+	return counter.reduce();
+}
+
+}
+
+// Reduces the range with a balanced tree of operations, as a binary counter does,
+// e.g. for a pairwise summation or a merge sort. The parallel policies split random access
+// ranges in a chunk per worker of the thread pool.
+template<typename P, InputIterator I, typename T, BinaryOperation Op>
+typename std::enable_if<execution::is_execution_policy<P>::value, T>::type reduce_balanced(P, I first, I last, Op op, const T& zero) {
+	return details::reduce_balanced(first, last, op, zero, details::runs_in_parallel<P, I>());
+}
+
 template<typename T, Integer N>
 struct counter {
 	N n;
@@ -937,10 +2052,10 @@ struct counter {
 };
 
 
-// split from marshall cow CppCon2016's presentation <https://github.com/CppCon/CppCon2016/blob/master/Presentations/STL%20Algorithms/STL%20Algorithms%20-%20Marshall%20Clow%20-%20CppCon%202016.pdf>
-// adapted to return the function.
+namespace details {
+
 template <ForwardIterator I, typename T, BinaryFunction F>
-F split(I first, I last, const T& val, F f) {
+F split(I first, I last, const T& val, F f, std::false_type) {
 	while (true) {
 		auto found = std::find(first, last, val);
 		f(first, found);
@@ -950,6 +2065,29 @@ F split(I first, I last, const T& val, F f) {
 	}
 	return f;
 }
+
+// the delimiters are taken from the masks of whole vectors, instead of a search per chunk.
+template<typename U, typename T, BinaryFunction F>
+F split(U* first, U* last, const T& val, F f, std::true_type) {
+	auto start = first;
+	simd::for_each_equal(static_cast<const T*>(first), static_cast<const T*>(last), val, [&](const T* found) {
+		auto delimiter = first + (found - first);
+		f(start, delimiter);
+		start = delimiter + 1;
+	});
+	f(start, last);
+	return f;
+}
+
+}
+
+// split from marshall cow CppCon2016's presentation <https://github.com/CppCon/CppCon2016/blob/master/Presentations/STL%20Algorithms/STL%20Algorithms%20-%20Marshall%20Clow%20-%20CppCon%202016.pdf>
+// adapted to return the function.
+// Vectorized when splitting an array of an arithmetic type.
+template <ForwardIterator I, typename T, BinaryFunction F>
+F split(I first, I last, const T& val, F f) {
+	return details::split(first, last, val, f, simd::is_searchable<I, T>());
+}
 /*
 // split from marshal cow's blog <https://cplusplusmusings.wordpress.com/2016/02/01/sometimes-you-get-things-wrong/>
 template <ForwardIterator I, Searcher S, OutputIterator O>
@@ -987,17 +2125,432 @@ F split_n(I first, N n, const T& val, F f) {
 	while (true) {
 		std::tie(found, n) = find_n(first, n, val);
 		f(first, found);
-		if (found == last)
+		if (n == 0)
 			return f;
 		first = ++found; // skip the delimiter
 		--n;
 	}
 }
 
+// Writes a bounded_range per chunk. The chunks are views of the input, nothing is copied.
+template<ForwardIterator I, typename T, OutputIterator O>
+O split_ranges(I first, I last, const T& val, O out) {
+	split(first, last, val, [&out](I f, I l) {
+		*out = bounded_range<I>(f, l);
+		++out;
+	});
+	return out;
+}
+
+namespace details {
+
+// The delimiters found from equally spaced positions, so that the segments between them can be split
+// independently: segment k starts after the delimiter k - 1 and ends at the delimiter k, the last one at last.
+template<RandomAccessIterator I, Function Find>
+std::vector<I> split_points(I first, I last, Find find) {
+	auto n = last - first;
+	auto segments = std::min<std::ptrdiff_t>(n / parallel_grain, 4 * (thread_pool::global().size() + 1));
+	std::vector<I> delimiters;
+	for (std::ptrdiff_t k = 1; k < segments; ++k) {
+		auto from = first + n * k / segments;
+		if (!delimiters.empty() && from <= delimiters.back())
+			from = delimiters.back() + 1;
+		auto found = find(from, last);
+		if (found == last)
+			break;
+		delimiters.push_back(found);
+	}
+	return delimiters;
+}
+
+// Calls segment(k, f, l) for each segment, concurrently.
+template<RandomAccessIterator I, Function S>
+void for_each_split_segment(I first, I last, const std::vector<I>& delimiters, S segment) {
+	thread_pool::global().for_each_index(delimiters.size() + 1, [&](std::size_t k) {
+		segment(k, k == 0 ? first : delimiters[k - 1] + 1, k == delimiters.size() ? last : delimiters[k]);
+	});
+}
+
+template<typename P, ForwardIterator I, typename T, BinaryFunction F>
+F split_with_policy(P, I first, I last, const T& val, F f, std::false_type) {
+	return xp::split(first, last, val, f);
+}
+
+template<typename P, RandomAccessIterator I, typename T, BinaryFunction F>
+F split_with_policy(P, I first, I last, const T& val, F f, std::true_type) {
+	if (last - first < 2 * parallel_grain)
+		return xp::split(first, last, val, f);
+	auto delimiters = split_points(first, last, [&](I from, I to) { return xp::find_n(from, to - from, val).first; });
+	for_each_split_segment(first, last, delimiters, [&](std::size_t, I from, I to) {
+		xp::split(from, to, val, [&f](I a, I b) { f(a, b); });
+	});
+	return f;
+}
+
+template<typename P, ForwardIterator I, UnaryPredicate Pred, BinaryFunction F>
+F split_if_with_policy(P, I first, I last, Pred pred, F f, std::false_type) {
+	return xp::split_if(first, last, pred, f);
+}
+
+template<typename P, RandomAccessIterator I, UnaryPredicate Pred, BinaryFunction F>
+F split_if_with_policy(P, I first, I last, Pred pred, F f, std::true_type) {
+	if (last - first < 2 * parallel_grain)
+		return xp::split_if(first, last, pred, f);
+	auto delimiters = split_points(first, last, [&](I from, I to) { return std::find_if(from, to, pred); });
+	for_each_split_segment(first, last, delimiters, [&](std::size_t, I from, I to) {
+		xp::split_if(from, to, pred, [&f](I a, I b) { f(a, b); });
+	});
+	return f;
+}
+
+template<typename P, ForwardIterator I, typename T, OutputIterator O>
+O split_ranges_with_policy(P, I first, I last, const T& val, O out, std::false_type) {
+	return xp::split_ranges(first, last, val, out);
+}
+
+template<typename P, RandomAccessIterator I, typename T, OutputIterator O>
+O split_ranges_with_policy(P, I first, I last, const T& val, O out, std::true_type) {
+	if (last - first < 2 * parallel_grain)
+		return xp::split_ranges(first, last, val, out);
+	auto delimiters = split_points(first, last, [&](I from, I to) { return xp::find_n(from, to - from, val).first; });
+	std::vector<std::vector<bounded_range<I>>> chunks(delimiters.size() + 1);
+	for_each_split_segment(first, last, delimiters, [&](std::size_t k, I from, I to) {
+		xp::split_ranges(from, to, val, std::back_inserter(chunks[k]));
+	});
+	for (auto& c : chunks)
+		out = std::copy(c.begin(), c.end(), out);
+	return out;
+}
+
+}
+
+// With a parallel policy, the range is cut at delimiters into segments split by different threads,
+// so f is called concurrently and must be thread safe. The chunks of a segment are passed in order.
+template<typename P, ForwardIterator I, typename T, BinaryFunction F>
+typename std::enable_if<execution::is_execution_policy<P>::value, F>::type split(P policy, I first, I last, const T& val, F f) {
+	return details::split_with_policy(policy, first, last, val, f, details::runs_in_parallel<P, I>());
+}
+
+template<typename P, ForwardIterator I, UnaryPredicate Pred, BinaryFunction F>
+typename std::enable_if<execution::is_execution_policy<P>::value, F>::type split_if(P policy, I first, I last, Pred pred, F f) {
+	return details::split_if_with_policy(policy, first, last, pred, f, details::runs_in_parallel<P, I>());
+}
+
+// The ranges are written in the order of the input, whatever the policy.
+template<typename P, ForwardIterator I, typename T, OutputIterator O>
+typename std::enable_if<execution::is_execution_policy<P>::value, O>::type split_ranges(P policy, I first, I last, const T& val, O out) {
+	return details::split_ranges_with_policy(policy, first, last, val, out, details::runs_in_parallel<P, I>());
+}
 
 // split_n_if
-// bucketize
-// bucketize_n
+
+namespace details {
+
+// The number of elements of each bucket among the n elements at first.
+template<ForwardIterator I, Integer N, Function Key>
+std::vector<std::size_t> bucket_counts(I first, N n, std::size_t buckets, Key key) {
+	std::vector<std::size_t> counts(buckets, 0);
+	while (n) {
+		++counts[static_cast<std::size_t>(key(*first))];
+		++first;
+		--n;
+	}
+	return counts;
+}
+
+// The element of bucket b is written at out[next[b]], next[b] being incremented.
+template<ForwardIterator I, Integer N, RandomAccessIterator O, Function Key>
+I bucketize_scatter(I first, N n, O out, std::vector<std::size_t> next, Key key, std::false_type) {
+	while (n) {
+		auto& i = next[static_cast<std::size_t>(key(*first))];
+		out[i] = *first;
+		++i;
+		++first;
+		--n;
+	}
+	return first;
+}
+
+// Software write combining: the elements are gathered in a buffer of a cache line per bucket, and a full buffer
+// is streamed to its line of the output, so that the scattered writes hit the cache and the output is never read.
+// The buffer of a bucket is indexed by the position of the element in its line of the output,
+// so only the first and the last lines of a bucket are partial, and copied as is.
+template<ForwardIterator I, Integer N, typename T, Function Key>
+I bucketize_scatter(I first, N n, T* out, std::vector<std::size_t> next, Key key, std::true_type) {
+	const std::size_t k = simd::cache_line / sizeof(T);
+	const std::size_t few_buckets = 64; // or fewer, whose lines stay in the L1 cache: the buffers would only add copies
+	if (next.size() <= few_buckets || reinterpret_cast<std::uintptr_t>(out) % sizeof(T) != 0)
+		return bucketize_scatter(first, n, out, std::move(next), key, std::false_type());
+
+	auto buckets = next.size();
+	auto start = next;
+	auto phase = (reinterpret_cast<std::uintptr_t>(out) % simd::cache_line) / sizeof(T); // of out[0] in its line
+	std::vector<unsigned char> storage((buckets + 1) * simd::cache_line);
+	auto lines = reinterpret_cast<T*>(storage.data() + simd::cache_line - reinterpret_cast<std::uintptr_t>(storage.data()) % simd::cache_line);
+	while (n) {
+		T x = *first;
+		auto b = static_cast<std::size_t>(key(x));
+		auto i = next[b]++;
+		auto line = lines + b * k;
+		auto j = (i + phase) % k;
+		std::memcpy(line + j, &x, sizeof(T));
+		if (j == k - 1) {
+			if (i + 1 >= start[b] + k)
+				simd::stream_line(out + i + 1 - k, line);
+			else
+				std::memcpy(out + start[b], line + (start[b] + phase) % k, (i + 1 - start[b]) * sizeof(T));
+		}
+		++first;
+		--n;
+	}
+	simd::store_fence();
+	for (std::size_t b = 0; b != buckets; ++b) {
+		auto from = next[b] - std::min((next[b] + phase) % k, next[b] - start[b]);
+		std::memcpy(out + from, lines + b * k + (from + phase) % k, (next[b] - from) * sizeof(T));
+	}
+	return first;
+}
+
+// The values are copied as bytes, by lines holding a whole number of values.
+template<typename I, typename O>
+struct is_write_combinable : std::false_type {};
+
+template<typename I, typename T>
+struct is_write_combinable<I, T*> : std::integral_constant<bool,
+	std::is_trivially_copyable<T>::value && simd::cache_line % sizeof(T) == 0
+	&& std::is_same<typename std::remove_cv<ValueType(I)>::type, T>::value> {};
+
+// offsets[b] is the start of the bucket b, offsets[buckets] the count of elements.
+inline std::vector<std::size_t> bucket_offsets(const std::vector<std::size_t>& counts) {
+	std::vector<std::size_t> offsets(counts.size() + 1, 0);
+	std::partial_sum(counts.begin(), counts.end(), offsets.begin() + 1);
+	return offsets;
+}
+
+}
+
+// Copies the n elements at first to out, grouped by bucket: a histogram pass counts the elements of each bucket,
+// then a scatter pass writes each element after the previous ones of its bucket, so the order is kept within a bucket.
+// key(x) must be in [0, buckets). Returns the end of the input and the offsets of the buckets in the output,
+// offsets[buckets] being n. Copying an array of trivially copyable values to an array goes through write combining buffers.
+template<ForwardIterator I, Integer N, RandomAccessIterator O, Function Key>
+std::pair<I, std::vector<std::size_t>> bucketize_n(I first, N n, O out, std::size_t buckets, Key key) {
+	auto offsets = details::bucket_offsets(details::bucket_counts(first, n, buckets, key));
+	first = details::bucketize_scatter(first, n, out, std::vector<std::size_t>(offsets.begin(), offsets.end() - 1), key, details::is_write_combinable<I, O>());
+	return{ first, std::move(offsets) };
+}
+
+template<ForwardIterator I, RandomAccessIterator O, Function Key>
+std::vector<std::size_t> bucketize(I first, I last, O out, std::size_t buckets, Key key) {
+	return bucketize_n(first, std::distance(first, last), out, buckets, key).second;
+}
+
+namespace details {
+
+template<typename P, ForwardIterator I, RandomAccessIterator O, Function Key>
+std::vector<std::size_t> bucketize_with_policy(P, I first, I last, O out, std::size_t buckets, Key key, std::false_type) {
+	return xp::bucketize_n(first, std::distance(first, last), out, buckets, key).second;
+}
+
+// Each chunk of the input is counted, then scattered to its own part of each bucket, in parallel.
+// The parts of a bucket are in the order of the chunks, so the result is the one of the sequential version.
+template<typename P, RandomAccessIterator I, RandomAccessIterator O, Function Key>
+std::vector<std::size_t> bucketize_with_policy(P, I first, I last, O out, std::size_t buckets, Key key, std::true_type) {
+	auto n = last - first;
+	auto& pool = thread_pool::global();
+	auto chunks = std::min<std::ptrdiff_t>(n / parallel_grain, 4 * (pool.size() + 1));
+	if (chunks < 2)
+		return xp::bucketize_n(first, n, out, buckets, key).second;
+
+	std::vector<std::vector<std::size_t>> counts(chunks);
+	pool.for_each_index(chunks, [&](std::size_t k) {
+		auto i = static_cast<std::ptrdiff_t>(k);
+		counts[k] = bucket_counts(first + n * i / chunks, n * (i + 1) / chunks - n * i / chunks, buckets, key);
+	});
+	std::vector<std::size_t> offsets(buckets + 1);
+	std::size_t next = 0;
+	for (std::size_t b = 0; b != buckets; ++b) {
+		offsets[b] = next;
+		for (auto& c : counts) {
+			auto count = c[b];
+			c[b] = next;
+			next += count;
+		}
+	}
+	offsets[buckets] = next;
+	pool.for_each_index(chunks, [&](std::size_t k) {
+		auto i = static_cast<std::ptrdiff_t>(k);
+		bucketize_scatter(first + n * i / chunks, n * (i + 1) / chunks - n * i / chunks, out, std::move(counts[k]), key, is_write_combinable<I, O>());
+	});
+	return offsets;
+}
+
+}
+
+// With a parallel policy, key is called concurrently.
+template<typename P, ForwardIterator I, RandomAccessIterator O, Function Key>
+typename std::enable_if<execution::is_execution_policy<P>::value, std::vector<std::size_t>>::type bucketize(P policy, I first, I last, O out, std::size_t buckets, Key key) {
+	return details::bucketize_with_policy(policy, first, last, out, buckets, key, details::runs_in_parallel<P, I>());
+}
+
+namespace details {
+
+template<InputIterator I1, InputIterator I2, OutputIterator O1, OutputIterator O2, OutputIterator O3, Relation Compare>
+std::tuple<O1, O2, O3> partition_sets_by_merge(I1 first1, I1 last1, I2 first2, I2 last2, O1 only1, O2 only2, O3 both, Compare cmp) {
+	while (first1 != last1 && first2 != last2) {
+		if (cmp(*first1, *first2)) {
+			*only1 = *first1;
+			++only1;
+			++first1;
+		}
+		else if (cmp(*first2, *first1)) {
+			*only2 = *first2;
+			++only2;
+			++first2;
+		}
+		else {
+			*both = *first1;
+			++both;
+			++first1;
+			++first2;
+		}
+	}
+	return std::make_tuple(std::copy(first1, last1, only1), std::copy(first2, last2, only2), both);
+}
+
+// the first element not less than val, searched with doubling steps from first,
+// so that the cost is logarithmic in the distance to the element rather than in the size of the range.
+template<RandomAccessIterator I, typename T, Relation Compare>
+I gallop_lower_bound(I first, I last, const T& val, Compare cmp) {
+	auto n = last - first;
+	DifferenceType(I) bound = 1;
+	while (bound <= n && cmp(first[bound - 1], val))
+		bound += bound;
+	return std::lower_bound(first + bound / 2, first + std::min(bound, n), val, cmp);
+}
+
+// Each element of the smaller range is searched in the larger one from the last element found,
+// so that the cost is O(m log(n / m)), m being the size of the smaller range.
+template<RandomAccessIterator I1, RandomAccessIterator I2, OutputIterator O1, OutputIterator O2, OutputIterator O3, Relation Compare>
+std::tuple<O1, O2, O3> partition_sets_by_galloping(I1 first1, I1 last1, I2 first2, I2 last2, O1 only1, O2 only2, O3 both, Compare cmp) {
+	if (last1 - first1 <= last2 - first2) {
+		for (; first1 != last1; ++first1) {
+			auto found = gallop_lower_bound(first2, last2, *first1, cmp);
+			only2 = std::copy(first2, found, only2);
+			first2 = found;
+			if (first2 != last2 && !cmp(*first1, *first2)) {
+				*both = *first1;
+				++both;
+				++first2;
+			}
+			else {
+				*only1 = *first1;
+				++only1;
+			}
+		}
+	}
+	else {
+		for (; first2 != last2; ++first2) {
+			auto found = gallop_lower_bound(first1, last1, *first2, cmp);
+			only1 = std::copy(first1, found, only1);
+			first1 = found;
+			if (first1 != last1 && !cmp(*first2, *first1)) {
+				*both = *first1;
+				++both;
+				++first1;
+			}
+			else {
+				*only2 = *first2;
+				++only2;
+			}
+		}
+	}
+	return std::make_tuple(std::copy(first1, last1, only1), std::copy(first2, last2, only2), both);
+}
+
+const std::ptrdiff_t galloping_ratio = 32; // of the sizes of the ranges, above which the galloping is faster than the merge
+
+template<RandomAccessIterator I1, RandomAccessIterator I2>
+bool prefers_galloping(I1 first1, I1 last1, I2 first2, I2 last2) {
+	auto n1 = last1 - first1;
+	auto n2 = last2 - first2;
+	return n1 >= galloping_ratio * n2 || n2 >= galloping_ratio * n1;
+}
+
+template<InputIterator I1, InputIterator I2, OutputIterator O1, OutputIterator O2, OutputIterator O3, Relation Compare>
+std::tuple<O1, O2, O3> partition_sets(I1 first1, I1 last1, I2 first2, I2 last2, O1 only1, O2 only2, O3 both, Compare cmp, std::false_type) {
+	return partition_sets_by_merge(first1, last1, first2, last2, only1, only2, both, cmp);
+}
+
+template<RandomAccessIterator I1, RandomAccessIterator I2, OutputIterator O1, OutputIterator O2, OutputIterator O3, Relation Compare>
+std::tuple<O1, O2, O3> partition_sets(I1 first1, I1 last1, I2 first2, I2 last2, O1 only1, O2 only2, O3 both, Compare cmp, std::true_type) {
+	if (prefers_galloping(first1, last1, first2, last2))
+		return partition_sets_by_galloping(first1, last1, first2, last2, only1, only2, both, cmp);
+	return partition_sets_by_merge(first1, last1, first2, last2, only1, only2, both, cmp);
+}
+
+// True when I1 and I2 are pointers to the same integer type of 32 bits.
+template<typename I1, typename I2>
+struct are_set_blocks : std::false_type {};
+
+template<typename U1, typename U2>
+struct are_set_blocks<U1*, U2*> : std::integral_constant<bool,
+	simd::has_set_blocks<typename std::remove_cv<U1>::type>::value && std::is_same<typename std::remove_cv<U1>::type, typename std::remove_cv<U2>::type>::value> {};
+
+template<InputIterator I1, InputIterator I2, OutputIterator O1, OutputIterator O2, OutputIterator O3>
+std::tuple<O1, O2, O3> partition_sets(I1 first1, I1 last1, I2 first2, I2 last2, O1 only1, O2 only2, O3 both, std::false_type) {
+	return partition_sets(first1, last1, first2, last2, only1, only2, both, std::less<>(), are_random_access<I1, I2>());
+}
+
+template<typename U1, typename U2, OutputIterator O1, OutputIterator O2, OutputIterator O3>
+std::tuple<O1, O2, O3> partition_sets(U1* first1, U1* last1, U2* first2, U2* last2, O1 only1, O2 only2, O3 both, std::true_type) {
+	typedef typename std::remove_cv<U1>::type T;
+	if (prefers_galloping(first1, last1, first2, last2))
+		return partition_sets_by_galloping(first1, last1, first2, last2, only1, only2, both, std::less<>());
+	return simd::partition_sets(static_cast<const T*>(first1), static_cast<const T*>(last1), static_cast<const T*>(first2), static_cast<const T*>(last2), only1, only2, both);
+}
+
+}
+
+// Writes the elements only in the first range to only1, the ones only in the second range to only2,
+// and the ones in both to both, in one pass. The ranges must be sorted according to cmp, without duplicates.
+// On random access ranges, when one range is much smaller than the other, its elements are searched
+// in the larger one instead of merging the ranges.
+template<InputIterator I1, InputIterator I2, OutputIterator O1, OutputIterator O2, OutputIterator O3, Relation Compare>
+std::tuple<O1, O2, O3> partition_sets(I1 first1, I1 last1, I2 first2, I2 last2, O1 only1, O2 only2, O3 both, Compare cmp) {
+	return details::partition_sets(first1, last1, first2, last2, only1, only2, both, cmp, details::are_random_access<I1, I2>());
+}
+
+// Arrays of integers of 32 bits are compared by blocks of 8 elements.
+template<InputIterator I1, InputIterator I2, OutputIterator O1, OutputIterator O2, OutputIterator O3>
+std::tuple<O1, O2, O3> partition_sets(I1 first1, I1 last1, I2 first2, I2 last2, O1 only1, O2 only2, O3 both) {
+	return details::partition_sets(first1, last1, first2, last2, only1, only2, both, details::are_set_blocks<I1, I2>());
+}
+
+// Same as partition_sets, for ranges that are not sorted. The elements of the first range are hashed,
+// then those of the second range are looked up, so that both and only2 are in the order of the second range,
+// and only1 in the order of the first range.
+template<ForwardIterator I1, InputIterator I2, OutputIterator O1, OutputIterator O2, OutputIterator O3>
+std::tuple<O1, O2, O3> partition_unsorted_sets(I1 first1, I1 last1, I2 first2, I2 last2, O1 only1, O2 only2, O3 both) {
+	std::unordered_set<ValueType(I1)> hashed(first1, last1);
+	for (; first2 != last2; ++first2) {
+		if (hashed.erase(*first2)) {
+			*both = *first2;
+			++both;
+		}
+		else {
+			*only2 = *first2;
+			++only2;
+		}
+	}
+	for (; first1 != last1; ++first1) {
+		if (hashed.count(*first1)) {
+			*only1 = *first1;
+			++only1;
+		}
+	}
+	return std::make_tuple(only1, only2, both);
+}
 
 } // namespace xp
 
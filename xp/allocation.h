@@ -0,0 +1,287 @@
+#ifndef __ALLOCATION_H__
+#define __ALLOCATION_H__
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <utility>
+
+#include "fakeconcepts.h"
+#include "benchmark.h"
+
+// Allocation tracking: counts the allocations, the bytes, the peak of live bytes and the
+// reallocations of a measured region.
+//
+// The counting_allocator reports to an allocation_stats, the global one by default.
+// To also track every call to the global operator new, link allocation_tracking.cpp in the program,
+// or define XP_REPLACE_OPERATOR_NEW before including this file in exactly one translation unit.
+// It is an opt-in of the whole program: every allocation then pays for the header and the atomic
+// counts, so it is not linked in the test program, whose benchmarks must match an untracked build.
+// The aligned forms of operator new, for over-aligned types, are replaced as well when the compiler
+// has them (__cpp_aligned_new).
+
+namespace xp {
+
+	struct allocation_counts {
+		std::size_t allocations;
+		std::size_t deallocations;
+		std::size_t reallocations; // allocations made while the allocator already owned storage
+		std::size_t bytes;         // allocated
+		std::size_t peak;          // of live bytes, above the live bytes at the start of the region
+
+		inline friend std::ostream& operator<<(std::ostream& os, const allocation_counts& x) {
+			return os << "allocations: " << x.allocations << ", deallocations: " << x.deallocations
+				<< ", reallocations: " << x.reallocations << ", bytes: " << x.bytes << ", peak: " << x.peak;
+		}
+	};
+
+	class allocation_stats {
+		std::atomic<std::size_t> allocations;
+		std::atomic<std::size_t> deallocations;
+		std::atomic<std::size_t> reallocations;
+		std::atomic<std::size_t> bytes;
+		std::atomic<std::size_t> live;
+		std::atomic<std::size_t> peak;
+
+	public:
+		constexpr allocation_stats() : allocations(0), deallocations(0), reallocations(0), bytes(0), live(0), peak(0) {}
+
+		allocation_stats(const allocation_stats&) = delete;
+		allocation_stats& operator=(const allocation_stats&) = delete;
+
+		// fed by counting_allocator and, when replaced, by the global operator new.
+		static allocation_stats& global() {
+			static allocation_stats instance;
+			return instance;
+		}
+
+		void on_allocate(std::size_t n, bool reallocation = false) {
+			allocations.fetch_add(1, std::memory_order_relaxed);
+			if (reallocation) reallocations.fetch_add(1, std::memory_order_relaxed);
+			bytes.fetch_add(n, std::memory_order_relaxed);
+			auto now = live.fetch_add(n, std::memory_order_relaxed) + n;
+			auto highest = peak.load(std::memory_order_relaxed);
+			while (highest < now && !peak.compare_exchange_weak(highest, now, std::memory_order_relaxed))
+				;
+		}
+
+		void on_deallocate(std::size_t n) {
+			deallocations.fetch_add(1, std::memory_order_relaxed);
+			live.fetch_sub(n, std::memory_order_relaxed);
+		}
+
+		std::size_t live_bytes() const {
+			return live.load(std::memory_order_relaxed);
+		}
+
+		// the peak is reset to the current live bytes, to track the peak of a region.
+		// Therefore, regions tracking the same stats should not overlap.
+		allocation_counts start_region() {
+			auto x = live.load(std::memory_order_relaxed);
+			peak.store(x, std::memory_order_relaxed);
+			return {allocations.load(std::memory_order_relaxed), deallocations.load(std::memory_order_relaxed),
+				reallocations.load(std::memory_order_relaxed), bytes.load(std::memory_order_relaxed), x};
+		}
+
+		// the counts since the start of the region.
+		allocation_counts since(const allocation_counts& start) const {
+			auto highest = peak.load(std::memory_order_relaxed);
+			return {allocations.load(std::memory_order_relaxed) - start.allocations,
+				deallocations.load(std::memory_order_relaxed) - start.deallocations,
+				reallocations.load(std::memory_order_relaxed) - start.reallocations,
+				bytes.load(std::memory_order_relaxed) - start.bytes,
+				highest > start.peak ? highest - start.peak : 0};
+		}
+	};
+
+	// Same interface as timer but reports the allocations.
+	class allocation_tracker {
+		allocation_stats* stats;
+		allocation_counts start;
+
+	public:
+		explicit allocation_tracker(allocation_stats& stats = allocation_stats::global()) : stats(&stats), start(stats.start_region()) {}
+
+		void reset() {
+			start = stats->start_region();
+		}
+
+		allocation_counts elapsed() const {
+			return stats->since(start);
+		}
+	};
+
+	// The storage is taken from malloc, so that it is not counted twice when the global
+	// operator new is replaced.
+	template<typename T>
+	class counting_allocator {
+		static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned types are not supported.");
+		template<typename U> friend class counting_allocator;
+
+		allocation_stats* stats;
+		std::size_t owned; // number of live blocks allocated through this instance
+
+	public:
+		typedef T value_type;
+
+		counting_allocator() : stats(&allocation_stats::global()), owned(0) {}
+		explicit counting_allocator(allocation_stats& stats) : stats(&stats), owned(0) {}
+		counting_allocator(const counting_allocator& x) : stats(x.stats), owned(0) {}
+		template<typename U>
+		counting_allocator(const counting_allocator<U>& x) : stats(x.stats), owned(0) {}
+
+		counting_allocator& operator=(const counting_allocator& x) {
+			stats = x.stats;
+			return *this;
+		}
+
+		T* allocate(std::size_t n) {
+			T* p = static_cast<T*>(std::malloc(n * sizeof(T)));
+			if (!p) throw std::bad_alloc();
+			stats->on_allocate(n * sizeof(T), owned != 0);
+			++owned;
+			return p;
+		}
+
+		void deallocate(T* p, std::size_t n) {
+			std::free(p);
+			stats->on_deallocate(n * sizeof(T));
+			if (owned) --owned;
+		}
+
+		allocation_stats& get_stats() const {
+			return *stats;
+		}
+
+		template<typename U>
+		inline friend bool operator==(const counting_allocator& x, const counting_allocator<U>& y) {
+			return x.stats == y.stats;
+		}
+		template<typename U>
+		inline friend bool operator!=(const counting_allocator& x, const counting_allocator<U>& y) {
+			return !(x == y);
+		}
+	};
+
+	// True when the global operator new is replaced, so that allocation_stats::global() counts every allocation.
+	inline bool operator_new_is_tracked() {
+		static int* volatile p; // so that the allocation cannot be elided
+		auto before = allocation_stats::global().live_bytes();
+		p = new int(0);
+		bool tracked = allocation_stats::global().live_bytes() != before;
+		delete p;
+		return tracked;
+	}
+
+	// Measures the repeated executions of f, and the allocations they made.
+	template<typename C, Function F>
+	requires(C is Chrono)
+	std::pair<typename C::duration, allocation_counts> measure_allocations(int repeat, F f, allocation_stats& stats = allocation_stats::global()) {
+		allocation_tracker a(stats);
+		auto d = measure<C>(repeat, f);
+		return {d, a.elapsed()};
+	}
+
+} // namespace xp
+
+#ifdef XP_REPLACE_OPERATOR_NEW
+
+// The size of the block is stored in a header, so that it is known on deletion.
+// The header keeps the alignment of the fundamental types.
+
+namespace xp {
+	namespace details {
+		const std::size_t allocation_header = alignof(std::max_align_t) < sizeof(std::size_t) ? sizeof(std::size_t) : alignof(std::max_align_t);
+
+		inline void* tracked_allocate(std::size_t n) noexcept {
+			auto p = static_cast<char*>(std::malloc(n + allocation_header));
+			if (!p) return nullptr;
+			*reinterpret_cast<std::size_t*>(p) = n;
+			allocation_stats::global().on_allocate(n);
+			return p + allocation_header;
+		}
+
+		inline void tracked_deallocate(void* ptr) noexcept {
+			if (!ptr) return;
+			auto p = static_cast<char*>(ptr) - allocation_header;
+			allocation_stats::global().on_deallocate(*reinterpret_cast<std::size_t*>(p));
+			std::free(p);
+		}
+
+		inline void* tracked_allocate_or_throw(std::size_t n) {
+			for (;;) {
+				if (auto p = tracked_allocate(n)) return p;
+				auto handler = std::get_new_handler();
+				if (!handler) throw std::bad_alloc();
+				handler();
+			}
+		}
+
+#ifdef __cpp_aligned_new
+		// Over-aligned blocks are taken in a larger one, the header being right before the aligned storage.
+		struct aligned_allocation_header {
+			void* block;
+			std::size_t n;
+		};
+
+		inline void* tracked_allocate(std::size_t n, std::align_val_t al) noexcept {
+			auto alignment = std::max(static_cast<std::size_t>(al), alignof(aligned_allocation_header));
+			auto block = static_cast<char*>(std::malloc(n + alignment + sizeof(aligned_allocation_header)));
+			if (!block) return nullptr;
+			auto start = reinterpret_cast<std::uintptr_t>(block + sizeof(aligned_allocation_header));
+			auto p = block + sizeof(aligned_allocation_header) + (alignment - start % alignment) % alignment;
+			reinterpret_cast<aligned_allocation_header*>(p)[-1] = {block, n};
+			allocation_stats::global().on_allocate(n);
+			return p;
+		}
+
+		inline void tracked_deallocate(void* ptr, std::align_val_t) noexcept {
+			if (!ptr) return;
+			auto header = static_cast<aligned_allocation_header*>(ptr)[-1];
+			allocation_stats::global().on_deallocate(header.n);
+			std::free(header.block);
+		}
+
+		inline void* tracked_allocate_or_throw(std::size_t n, std::align_val_t al) {
+			for (;;) {
+				if (auto p = tracked_allocate(n, al)) return p;
+				auto handler = std::get_new_handler();
+				if (!handler) throw std::bad_alloc();
+				handler();
+			}
+		}
+#endif
+	}
+}
+
+void* operator new(std::size_t n) { return xp::details::tracked_allocate_or_throw(n); }
+void* operator new[](std::size_t n) { return xp::details::tracked_allocate_or_throw(n); }
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept { return xp::details::tracked_allocate(n); }
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept { return xp::details::tracked_allocate(n); }
+void operator delete(void* p) noexcept { xp::details::tracked_deallocate(p); }
+void operator delete[](void* p) noexcept { xp::details::tracked_deallocate(p); }
+void operator delete(void* p, std::size_t) noexcept { xp::details::tracked_deallocate(p); }
+void operator delete[](void* p, std::size_t) noexcept { xp::details::tracked_deallocate(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { xp::details::tracked_deallocate(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { xp::details::tracked_deallocate(p); }
+
+#ifdef __cpp_aligned_new
+void* operator new(std::size_t n, std::align_val_t al) { return xp::details::tracked_allocate_or_throw(n, al); }
+void* operator new[](std::size_t n, std::align_val_t al) { return xp::details::tracked_allocate_or_throw(n, al); }
+void* operator new(std::size_t n, std::align_val_t al, const std::nothrow_t&) noexcept { return xp::details::tracked_allocate(n, al); }
+void* operator new[](std::size_t n, std::align_val_t al, const std::nothrow_t&) noexcept { return xp::details::tracked_allocate(n, al); }
+void operator delete(void* p, std::align_val_t al) noexcept { xp::details::tracked_deallocate(p, al); }
+void operator delete[](void* p, std::align_val_t al) noexcept { xp::details::tracked_deallocate(p, al); }
+void operator delete(void* p, std::size_t, std::align_val_t al) noexcept { xp::details::tracked_deallocate(p, al); }
+void operator delete[](void* p, std::size_t, std::align_val_t al) noexcept { xp::details::tracked_deallocate(p, al); }
+void operator delete(void* p, std::align_val_t al, const std::nothrow_t&) noexcept { xp::details::tracked_deallocate(p, al); }
+void operator delete[](void* p, std::align_val_t al, const std::nothrow_t&) noexcept { xp::details::tracked_deallocate(p, al); }
+#endif
+
+#endif
+
+#endif __ALLOCATION_H__
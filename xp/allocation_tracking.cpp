@@ -0,0 +1,4 @@
+// Replaces the global operator new and delete, so that allocation_stats::global() counts every allocation
+// of the program. Link it only in the programs measuring their allocations, see allocation.h.
+#define XP_REPLACE_OPERATOR_NEW
+#include "allocation.h"
@@ -2,17 +2,33 @@
 #define __BENCHMARK_H__
 
 #include <cassert>
+#include <cmath>
 #include <ctime>
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <iostream>
 #include <ratio>
 #include <string>
 #include <tuple>
+#include <type_traits>
+#include <vector>
 
 #include "fakeconcepts.h"
 
 namespace xp {
 
+	// True when the ticks of the Chrono C are time. A clock counting events, such as cycle_clock,
+	// specializes it as false: its durations cannot be converted, so the benchmarks report ticks.
+	template<typename C>
+	struct ticks_are_time : std::true_type {};
+
+	// The unit of the results of run_benchmark and loop_overhead.
+	template<typename C>
+	using benchmark_duration = typename std::conditional<ticks_are_time<C>::value,
+		std::chrono::duration<double, std::nano>,
+		std::chrono::duration<double, typename C::period>>::type;
+
 	template<typename C>
 	requires(C is Chrono)
 	class timer {
@@ -74,6 +90,64 @@ namespace xp {
 		}
 	};
 
+	// Optimization barriers, from Chandler Carruth's CppCon 2015 talk "Tuning C++"
+	// <https://www.youtube.com/watch?v=nXaxk27zwlk>
+	// do_not_optimize forces the value to be computed and considered observed.
+	// clobber_memory forces all pending writes to memory and prevents the compiler
+	// from assuming the memory was not modified.
+#if defined(__GNUC__) || defined(__clang__)
+	template<typename T>
+	inline void do_not_optimize(const T& value) {
+		asm volatile("" : : "r,m"(value) : "memory");
+	}
+
+	inline void clobber_memory() {
+		asm volatile("" : : : "memory");
+	}
+#else
+	namespace details {
+		template<typename T>
+		inline void escape(const volatile T* p) {
+			static const volatile void* volatile sink;
+			sink = p;
+		}
+	}
+
+	template<typename T>
+	inline void do_not_optimize(const T& value) {
+		details::escape(&value);
+		std::atomic_signal_fence(std::memory_order_seq_cst);
+	}
+
+	inline void clobber_memory() {
+		std::atomic_signal_fence(std::memory_order_seq_cst);
+	}
+#endif
+
+	namespace details {
+
+		template<Function F>
+		inline void invoke_observed(F& f, std::true_type) {
+			f();
+			clobber_memory();
+		}
+
+		template<Function F>
+		inline void invoke_observed(F& f, std::false_type) {
+			auto r = f();
+			do_not_optimize(r);
+		}
+
+		// Calls f so that neither the call nor its result can be optimized away.
+		// f itself is observed too, so that the call cannot be hoisted out of the loop.
+		template<Function F>
+		inline void invoke_observed(F& f) {
+			do_not_optimize(f);
+			invoke_observed(f, typename std::is_void<decltype(f())>::type());
+		}
+
+	} // namespace details
+
 	// TODO: Fix name and operator
 	template<typename D>
 	requires(D is Duration)
@@ -113,10 +187,10 @@ namespace xp {
 			N i = 0;
 			timer<C> t;
 			while (i < n) {
-				f();
+				details::invoke_observed(f);
 				++i;
 			}
-			auto d = t.elapsed<D>();
+			auto d = t.template elapsed<D>();
 			if (d > threshold) return {d, n};
 			n += n; // double it.
 		}
@@ -128,9 +202,251 @@ namespace xp {
 
 		timer<C> t;
 		while (repeat--) {
-			f();
+			details::invoke_observed(f);
+		}
+		return t.template elapsed<D>();
+	}
+
+	// samples keeps every measure so that order statistics can be computed.
+	// It has the same interface as measures, so it can replace it in existing benches.
+	template<typename D>
+	requires(D is Duration)
+	class samples {
+		mutable std::vector<D> values;
+		mutable bool sorted;
+
+		const std::vector<D>& ordered() const {
+			if (!sorted) {
+				std::sort(values.begin(), values.end());
+				sorted = true;
+			}
+			return values;
+		}
+
+	public:
+		typedef D duration;
+		typedef typename std::vector<D>::const_iterator const_iterator;
+
+		samples() : sorted(true) {}
+
+		samples& operator += (D d) {
+			if (sorted && !values.empty() && d < values.back()) sorted = false;
+			values.push_back(d);
+			return *this;
+		}
+
+		std::size_t size() const { return values.size(); }
+		bool empty() const { return values.empty(); }
+		void reserve(std::size_t n) { values.reserve(n); }
+
+		// the samples, sorted in ascending order.
+		const_iterator begin() const { return ordered().begin(); }
+		const_iterator end() const { return ordered().end(); }
+
+		D min() const { assert(!empty()); return ordered().front(); }
+		D max() const { assert(!empty()); return ordered().back(); }
+		D avg() const {
+			assert(!empty());
+			typedef std::chrono::duration<double, typename D::period> F;
+			F sum = F::zero();
+			for (auto d : values) sum += d;
+			return std::chrono::duration_cast<D>(sum / double(values.size()));
+		}
+
+		// linear interpolation between the closest ranks, 0 <= p <= 1.
+		D percentile(double p) const {
+			assert(!empty() && 0. <= p && p <= 1.);
+			typedef std::chrono::duration<double, typename D::period> F;
+			auto& v = ordered();
+			double rank = p * (v.size() - 1);
+			std::size_t i = static_cast<std::size_t>(rank);
+			if (i + 1 == v.size()) return v[i];
+			F lo = v[i];
+			F hi = v[i + 1];
+			return std::chrono::duration_cast<D>(lo + (hi - lo) * (rank - i));
+		}
+		D median() const { return percentile(.5); }
+
+		// median absolute deviation
+		D mad() const {
+			assert(!empty());
+			D m = median();
+			samples deviations;
+			deviations.reserve(size());
+			for (auto d : values) deviations += (d < m) ? m - d : d - m;
+			return deviations.median();
+		}
+	};
+
+	template<typename D>
+	requires(D is Duration)
+	struct statistics {
+		std::size_t n;        // number of samples kept
+		std::size_t outliers; // number of samples discarded
+		D min;
+		D max;
+		D mean;
+		D stddev;
+		D median;
+		D mad;
+		D p90;
+		D p99;
+		D ci_lower;           // 95% confidence interval of the mean
+		D ci_upper;
+	};
+
+	// Discards the samples whose modified z-score, based on the median and the MAD, 
+	// exceeds the threshold, then computes the statistics on the remaining samples.
+	// Iglewicz and Hoaglin recommend a threshold of 3.5.
+	template<typename D>
+	requires(D is Duration)
+	statistics<D> summarize(const samples<D>& all, double threshold = 3.5) {
+		typedef std::chrono::duration<double, typename D::period> F;
+		assert(!all.empty());
+
+		F median = all.median();
+		F spread = F(all.mad()) * 1.4826; // consistent estimator of the standard deviation
+		samples<D> kept;
+		kept.reserve(all.size());
+		for (auto d : all) {
+			F deviation = F(d) - median;
+			if (spread == F::zero() || std::abs(deviation / spread) <= threshold)
+				kept += d;
+		}
+
+		statistics<D> r;
+		r.n = kept.size();
+		r.outliers = all.size() - kept.size();
+		r.min = kept.min();
+		r.max = kept.max();
+		r.median = kept.median();
+		r.mad = kept.mad();
+		r.p90 = kept.percentile(.90);
+		r.p99 = kept.percentile(.99);
+
+		F mean = F::zero();
+		for (auto d : kept) mean += d;
+		mean /= double(r.n);
+		double variance = 0.;
+		for (auto d : kept) {
+			double x = (F(d) - mean).count();
+			variance += x * x;
+		}
+		if (r.n > 1) variance /= double(r.n - 1);
+		F stddev = F(std::sqrt(variance));
+		F error = stddev * (1.96 / std::sqrt(double(r.n))); // normal approximation
+		r.mean = std::chrono::duration_cast<D>(mean);
+		r.stddev = std::chrono::duration_cast<D>(stddev);
+		r.ci_lower = std::chrono::duration_cast<D>(mean - error);
+		r.ci_upper = std::chrono::duration_cast<D>(mean + error);
+		return r;
+	}
+
+	// The most executions in a batch, so that calibrate ends when the body was optimized away
+	// and the clock is too coarse to see it run. long is 32 bits with msvc.
+	const long max_batch = 1L << 30;
+
+	// Returns the number of executions of f needed to exceed the target duration, at most limit.
+	template<typename C, Function F>
+	requires(C is Chrono)
+	long calibrate(F f, typename C::duration target, long limit = max_batch) {
+		typedef long N;
+		typedef typename C::duration D;
+
+		N n = 1;
+		for (;;) {
+			N i = 0;
+			timer<C> t;
+			while (i < n) {
+				details::invoke_observed(f);
+				++i;
+			}
+			if (t.template elapsed<D>() >= target || n >= limit) return n;
+			n = n < limit - n ? n + n : limit;
+		}
+	}
+
+	namespace details {
+
+		template<typename C, Function F>
+		long calibrate_batch(F f, std::chrono::nanoseconds target, std::true_type) {
+			return calibrate<C>(f, std::chrono::duration_cast<typename C::duration>(target));
+		}
+
+		// the target is a time, so the batch is calibrated on the steady clock.
+		template<typename C, Function F>
+		long calibrate_batch(F f, std::chrono::nanoseconds target, std::false_type) {
+			return calibrate<std::chrono::steady_clock>(f, target);
+		}
+
+	} // namespace details
+
+	// Returns the duration of one iteration of the measuring loop, with an empty body.
+	template<typename C>
+	requires(C is Chrono)
+	benchmark_duration<C> loop_overhead(long n = 1000000) {
+		typedef benchmark_duration<C> D;
+		auto empty = []() {};
+		samples<D> s;
+		for (int k = 0; k != 5; ++k) {
+			timer<C> t;
+			for (long i = 0; i != n; ++i)
+				details::invoke_observed(empty);
+			s += t.template elapsed<D>() / double(n);
+		}
+		return s.median();
+	}
+
+	// A body that runs in less than twice the loop overhead has probably been
+	// partially or completely eliminated by the optimizer.
+	template<typename D1, typename D2>
+	bool is_suspiciously_fast(D1 body, D2 overhead) {
+		return body < overhead * 2;
+	}
+
+	struct benchmark_options {
+		int warmup;                       // number of batches run before sampling
+		int sample_count;                 // number of batches sampled
+		std::chrono::nanoseconds target;  // the duration of a batch
+		double outlier_threshold;         // in modified z-score
+		bool check_overhead;              // warns when the body is not slower than the loop itself
+
+		benchmark_options() : warmup(3), sample_count(30), target(std::chrono::milliseconds(10)), outlier_threshold(3.5), check_overhead(true) {}
+	};
+
+	// Calibrates the size of a batch so that it lasts the target duration, runs the warmup batches,
+	// then samples the duration of one execution of f for each batch.
+	// The durations are in nanoseconds, or in ticks of C when they are not time.
+	template<typename C, Function F>
+	requires(C is Chrono)
+	statistics<benchmark_duration<C>> run_benchmark(F f, const benchmark_options& options = benchmark_options()) {
+		typedef benchmark_duration<C> D;
+		assert(options.sample_count > 0);
+
+		long n = details::calibrate_batch<C>(f, options.target, ticks_are_time<C>());
+		for (int w = 0; w != options.warmup; ++w) {
+			for (long i = 0; i != n; ++i)
+				details::invoke_observed(f);
+		}
+
+		samples<D> s;
+		s.reserve(options.sample_count);
+		for (int k = 0; k != options.sample_count; ++k) {
+			timer<C> t;
+			for (long i = 0; i != n; ++i)
+				details::invoke_observed(f);
+			s += t.template elapsed<D>() / double(n);
+		}
+		auto r = summarize(s, options.outlier_threshold);
+
+		if (options.check_overhead) {
+			auto overhead = loop_overhead<C>(n);
+			const char* unit = ticks_are_time<C>::value ? "ns" : "ticks";
+			if (is_suspiciously_fast(r.median, overhead))
+				std::clog << "  warning: the body runs in " << r.median.count() << " " << unit << ", close to the loop overhead of "
+					<< overhead.count() << " " << unit << ". It may have been optimized away." << std::endl;
 		}
-		return t.elapsed<D>();
+		return r;
 	}
 
 	template<typename T, typename Tag = std::string>
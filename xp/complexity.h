@@ -0,0 +1,275 @@
+#ifndef __COMPLEXITY_H__
+#define __COMPLEXITY_H__
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "fakeconcepts.h"
+#include "benchmark.h"
+#include "hardware_counters.h"
+#include "instrumented.h"
+#include "numeric.h"
+
+// Empirical complexity: sweeps of input sizes and shapes, and least squares fitting
+// of the measured costs to the usual complexity classes.
+// The costs are either timings or, deterministically, the operations counted by instrumented<T>.
+
+namespace xp {
+
+	struct complexity {
+		enum classes { o_1, o_log_n, o_n, o_n_log_n, o_n2, o_n3, n };
+
+		static const char* name(classes c) {
+			static const char* names[n] = {"O(1)", "O(log N)", "O(N)", "O(N log N)", "O(N^2)", "O(N^3)"};
+			return names[c];
+		}
+
+		static double evaluate(classes c, double x) {
+			switch (c) {
+			case o_1: return 1.;
+			case o_log_n: return std::log2(x);
+			case o_n: return x;
+			case o_n_log_n: return x * std::log2(x);
+			case o_n2: return x * x;
+			case o_n3: return x * x * x;
+			default: return 0.;
+			}
+		}
+	};
+
+	struct complexity_fit {
+		complexity::classes order;
+		double coefficient; // cost ~ coefficient * order(N)
+		double rms;         // root mean square of the residuals, relative to the mean cost
+	};
+
+	// Fits cost = c * g(N) for each complexity class g, by least squares,
+	// and returns the class with the lowest relative error.
+	// The value type of the iterator is a pair (N, cost).
+	template<InputIterator I>
+	complexity_fit fit_complexity(I first, I last) {
+		std::vector<std::pair<double, double>> points;
+		for (; first != last; ++first)
+			points.emplace_back(double(first->first), double(first->second));
+
+		complexity_fit best = {complexity::o_1, 0., std::numeric_limits<double>::infinity()};
+		if (points.empty()) return best;
+
+		double mean = 0.;
+		for (auto& p : points) mean += p.second;
+		mean /= points.size();
+
+		for (int k = 0; k != complexity::n; ++k) {
+			auto c = static_cast<complexity::classes>(k);
+			double gg = 0., gy = 0.;
+			for (auto& p : points) {
+				double g = complexity::evaluate(c, p.first);
+				gg += g * g;
+				gy += g * p.second;
+			}
+			if (gg == 0.) continue;
+			double coefficient = gy / gg;
+			double residuals = 0.;
+			for (auto& p : points) {
+				double r = p.second - coefficient * complexity::evaluate(c, p.first);
+				residuals += r * r;
+			}
+			double rms = std::sqrt(residuals / points.size());
+			if (mean != 0.) rms /= mean;
+			if (rms < best.rms)
+				best = {c, coefficient, rms};
+		}
+		return best;
+	}
+
+	// first, first * factor, first * factor^2, ... up to last, included.
+	inline std::vector<std::size_t> geometric_sizes(std::size_t first, std::size_t last, double factor = 2.) {
+		std::vector<std::size_t> sizes;
+		for (double n = double(first); n <= double(last); n *= factor) {
+			auto x = static_cast<std::size_t>(n);
+			if (sizes.empty() || sizes.back() != x)
+				sizes.push_back(x);
+		}
+		return sizes;
+	}
+
+	struct input_shape {
+		enum shapes { sorted, reversed, random, few_unique, n };
+
+		static const char* name(shapes s) {
+			static const char* names[n] = {"sorted", "reversed", "random", "few_unique"};
+			return names[s];
+		}
+	};
+
+	// Fills the range with a permutation of 0..N-1 in the requested order,
+	// or, for few_unique, with a shuffled sequence of 16 distinct values.
+	template<RandomAccessIterator I, class URNG>
+	void fill_shape(I first, I last, input_shape::shapes s, URNG&& g) {
+		typedef ValueType(I) T;
+		auto n = last - first;
+		switch (s) {
+		case input_shape::sorted:
+			iota_n(first, n, T(0));
+			break;
+		case input_shape::reversed:
+			reverse_iota_n(first, n, T(n - 1));
+			break;
+		case input_shape::random:
+			random_iota(first, last, T(0), std::forward<URNG>(g));
+			break;
+		case input_shape::few_unique:
+			for (auto i = first; i != last; ++i)
+				*i = T((i - first) % 16);
+			std::shuffle(first, last, std::forward<URNG>(g));
+			break;
+		default:
+			break;
+		}
+	}
+
+	struct family_point {
+		std::size_t n;
+		statistics<std::chrono::duration<double, std::nano>> stats;
+		double per_element_ns;
+		const char* regime; // where the input fits in the memory hierarchy
+	};
+
+	struct family_result {
+		std::string name;
+		input_shape::shapes shape;
+		std::vector<family_point> points;
+		complexity_fit fit;
+	};
+
+	// Runs the benchmark of f on inputs of each shape and size.
+	// f is called with a const reference to the input, so an algorithm that mutates its
+	// input must work on a copy, whose cost is then measured as well.
+	template<typename C, typename T, Function F>
+	requires(C is Chrono)
+	std::vector<family_result> run_family(const std::string& name, const std::vector<std::size_t>& sizes, const std::vector<input_shape::shapes>& shapes, F f, const benchmark_options& options = benchmark_options()) {
+		static_assert(ticks_are_time<C>::value, "the costs are reported in nanoseconds");
+		auto& caches = cache_sizes::local();
+		std::vector<family_result> results;
+		for (auto shape : shapes) {
+			family_result r;
+			r.name = name;
+			r.shape = shape;
+			std::vector<std::pair<double, double>> costs;
+			for (auto n : sizes) {
+				std::vector<T> input(n);
+				fill_shape(input.begin(), input.end(), shape, std::mt19937 {1664});
+				const std::vector<T>& x = input;
+
+				family_point p;
+				p.n = n;
+				p.stats = run_benchmark<C>([&]() { f(x); }, options);
+				p.per_element_ns = n ? p.stats.median.count() / n : 0.;
+				p.regime = caches.regime(n * sizeof(T));
+				r.points.push_back(p);
+				costs.emplace_back(double(n), p.stats.median.count());
+			}
+			r.fit = fit_complexity(costs.begin(), costs.end());
+			results.push_back(std::move(r));
+		}
+		return results;
+	}
+
+	// Prints a line per size, flagging the changes of cache regime, then the fitted complexity.
+	inline void print_family(std::ostream& os, const family_result& r) {
+		os << "  " << r.name << " (" << input_shape::name(r.shape) << ")" << std::endl;
+		const family_point* previous = nullptr;
+		for (auto& p : r.points) {
+			os << "    N=" << p.n << ": median " << p.stats.median.count() << " ns, " << p.per_element_ns << " ns/element, " << p.regime;
+			if (previous && std::string(previous->regime) != p.regime && previous->per_element_ns != 0.)
+				os << " <- " << previous->regime << " to " << p.regime << " transition, x" << p.per_element_ns / previous->per_element_ns << " per element";
+			os << std::endl;
+			previous = &p;
+		}
+		os << "    fit: " << complexity::name(r.fit.order) << ", coefficient " << r.fit.coefficient << ", rms " << r.fit.rms << std::endl;
+	}
+
+	struct operation_point {
+		std::size_t n;
+		instrumented_base::operation_counts counts;
+	};
+
+	struct operation_table {
+		std::string name;
+		input_shape::shapes shape;
+		std::vector<operation_point> points;
+
+		complexity_fit fit(instrumented_base::operations op) const {
+			std::vector<std::pair<double, double>> costs;
+			for (auto& p : points)
+				costs.emplace_back(double(p.n), double(p.counts[op]));
+			return fit_complexity(costs.begin(), costs.end());
+		}
+
+		// Returns the first point whose count of op exceeds bound(N), or nullptr.
+		template<Function Bound>
+		const operation_point* find_violation(instrumented_base::operations op, Bound bound) const {
+			for (auto& p : points) {
+				if (double(p.counts[op]) > bound(double(p.n)))
+					return &p;
+			}
+			return nullptr;
+		}
+	};
+
+	// Counts the operations made by f on inputs of each shape and size.
+	// f is called with a reference to the input, which it may mutate. The construction of
+	// the input is not counted, its destruction is.
+	template<Semiregular T, Function F>
+	std::vector<operation_table> count_operations(const std::string& name, const std::vector<std::size_t>& sizes, const std::vector<input_shape::shapes>& shapes, F f) {
+		std::vector<operation_table> tables;
+		for (auto shape : shapes) {
+			operation_table t;
+			t.name = name;
+			t.shape = shape;
+			for (auto n : sizes) {
+				std::vector<T> values(n);
+				fill_shape(values.begin(), values.end(), shape, std::mt19937 {1664});
+
+				operation_point p;
+				p.n = n;
+				{
+					std::vector<instrumented<T>> input(values.begin(), values.end());
+					auto before = instrumented_base::snapshot();
+					f(input);
+					input.clear();
+					p.counts = instrumented_base::snapshot() - before;
+				}
+				t.points.push_back(p);
+			}
+			tables.push_back(std::move(t));
+		}
+		return tables;
+	}
+
+	// Prints a line per size with the count of op normalized by N, N log N and N^2, then the fitted complexity.
+	inline void print_operations(std::ostream& os, const operation_table& t, instrumented_base::operations op) {
+		os << "  " << t.name << " (" << input_shape::name(t.shape) << "), " << instrumented_base::names[op] << std::endl;
+		for (auto& p : t.points) {
+			double n = double(p.n);
+			double x = double(p.counts[op]);
+			os << "    N=" << p.n << ": " << p.counts[op];
+			if (p.n > 1)
+				os << ", /N " << x / n << ", /N log N " << x / (n * std::log2(n)) << ", /N^2 " << x / (n * n);
+			os << std::endl;
+		}
+		auto fit = t.fit(op);
+		os << "    fit: " << complexity::name(fit.order) << ", coefficient " << fit.coefficient << ", rms " << fit.rms << std::endl;
+	}
+
+} // namespace xp
+
+#endif __COMPLEXITY_H__
@@ -0,0 +1,165 @@
+#ifndef __EXECUTION_H__
+#define __EXECUTION_H__
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "fakeconcepts.h"
+
+// Execution policies, similar to the ones of C++17, and the thread pool running the parallel algorithms.
+// An algorithm called with the parallel policies may split the range and combine the partial results,
+// so its operation must be associative. It is never required to be commutative: the partial results
+// are combined in the order of the range.
+
+namespace xp {
+
+	namespace execution {
+
+		struct sequenced_policy {};
+		struct unsequenced_policy {};
+		struct parallel_policy {};
+		struct parallel_unsequenced_policy {};
+
+		const sequenced_policy seq = {};
+		const unsequenced_policy unseq = {};
+		const parallel_policy par = {};
+		const parallel_unsequenced_policy par_unseq = {};
+
+		template<typename P>
+		struct is_execution_policy : std::false_type {};
+		template<> struct is_execution_policy<sequenced_policy> : std::true_type {};
+		template<> struct is_execution_policy<unsequenced_policy> : std::true_type {};
+		template<> struct is_execution_policy<parallel_policy> : std::true_type {};
+		template<> struct is_execution_policy<parallel_unsequenced_policy> : std::true_type {};
+
+		// the range may be split across threads.
+		template<typename P>
+		struct is_parallel : std::false_type {};
+		template<> struct is_parallel<parallel_policy> : std::true_type {};
+		template<> struct is_parallel<parallel_unsequenced_policy> : std::true_type {};
+
+		// the operations may be interleaved on a single thread.
+		template<typename P>
+		struct is_unsequenced : std::false_type {};
+		template<> struct is_unsequenced<unsequenced_policy> : std::true_type {};
+		template<> struct is_unsequenced<parallel_unsequenced_policy> : std::true_type {};
+
+	} // namespace execution
+
+	class thread_pool {
+		std::mutex m;
+		std::condition_variable cv;
+		std::deque<std::function<void()>> tasks;
+		std::vector<std::thread> workers;
+		bool stopping;
+
+		void work() {
+			for (;;) {
+				std::function<void()> task;
+				{
+					std::unique_lock<std::mutex> lock(m);
+					cv.wait(lock, [this]() { return stopping || !tasks.empty(); });
+					if (tasks.empty()) return;
+					task = std::move(tasks.front());
+					tasks.pop_front();
+				}
+				task();
+			}
+		}
+
+	public:
+		explicit thread_pool(unsigned threads) : stopping(false) {
+			for (unsigned i = 0; i != threads; ++i)
+				workers.emplace_back([this]() { work(); });
+		}
+
+		~thread_pool() {
+			{
+				std::lock_guard<std::mutex> lock(m);
+				stopping = true;
+			}
+			cv.notify_all();
+			for (auto& w : workers)
+				w.join();
+		}
+
+		thread_pool(const thread_pool&) = delete;
+		thread_pool& operator=(const thread_pool&) = delete;
+
+		// a worker per core, the calling thread taking the part of the last one.
+		static thread_pool& global() {
+			static thread_pool instance(std::max(1u, std::thread::hardware_concurrency()) - 1);
+			return instance;
+		}
+
+		unsigned size() const {
+			return static_cast<unsigned>(workers.size());
+		}
+
+		void submit(std::function<void()> task) {
+			{
+				std::lock_guard<std::mutex> lock(m);
+				tasks.push_back(std::move(task));
+			}
+			cv.notify_one();
+		}
+
+		// Calls f(i) for each i in [0, n), on the workers and on the calling thread, and returns when all the calls returned.
+		// The calling thread takes its share of the calls, so for_each_index can be called from a task of the pool.
+		// The first exception thrown by f is rethrown.
+		template<Function F>
+		void for_each_index(std::size_t n, F f) {
+			struct state {
+				std::atomic<std::size_t> next;
+				std::size_t n;
+				F f;
+				std::mutex m;
+				std::condition_variable cv;
+				std::size_t done;
+				std::exception_ptr error;
+
+				state(std::size_t n, F f) : next(0), n(n), f(std::move(f)), done(0) {}
+
+				void run() {
+					for (;;) {
+						auto i = next.fetch_add(1, std::memory_order_relaxed);
+						if (i >= n) return;
+						try {
+							f(i);
+						}
+						catch (...) {
+							std::lock_guard<std::mutex> lock(m);
+							if (!error) error = std::current_exception();
+						}
+						std::lock_guard<std::mutex> lock(m);
+						if (++done == n) cv.notify_all();
+					}
+				}
+			};
+
+			if (n == 0) return;
+			auto s = std::make_shared<state>(n, std::move(f));
+			auto helpers = std::min<std::size_t>(size(), n - 1);
+			for (std::size_t k = 0; k != helpers; ++k)
+				submit([s]() { s->run(); });
+			s->run();
+			std::unique_lock<std::mutex> lock(s->m);
+			s->cv.wait(lock, [&]() { return s->done == s->n; });
+			if (s->error) std::rethrow_exception(s->error);
+		}
+	};
+
+} // namespace xp
+
+#endif __EXECUTION_H__
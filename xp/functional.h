@@ -236,7 +236,7 @@ namespace xp {
 	template<BinaryOperation Op>
 	class transpose_function_t {
 		Op op;
-		typedef Domain(Op) T;
+		typedef typename std::decay<Domain(Op)>::type T; // the arguments may be references, as in std::minus
 	public:
 		transpose_function_t(Op op) : op(op) {}
 
@@ -0,0 +1,278 @@
+#ifndef __HARDWARE_COUNTERS_H__
+#define __HARDWARE_COUNTERS_H__
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <ratio>
+#include <string>
+#include <type_traits>
+
+#if defined(__linux__)
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define XP_HAS_PERF_EVENTS
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define XP_HAS_RDTSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define XP_HAS_RDTSC
+#endif
+
+#include "benchmark.h"
+
+// Hardware performance counters, read through perf_event_open on Linux.
+// When the events are not permitted (perf_event_paranoid, containers, other platforms),
+// the counters are reported as unavailable and the cycle_clock falls back to rdtsc or,
+// failing that, to the steady_clock.
+
+namespace xp {
+
+	struct hardware_event {
+		enum events { cycles, instructions, l1d_misses, llc_misses, branch_misses, n };
+		static const char* name(events e) {
+			static const char* names[n] = {"cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses"};
+			return names[e];
+		}
+	};
+
+	// the counters of the calling thread.
+	class hardware_counters {
+		int fds[hardware_event::n];
+
+#ifdef XP_HAS_PERF_EVENTS
+		static int open(std::uint32_t type, std::uint64_t config) {
+			perf_event_attr attr;
+			std::memset(&attr, 0, sizeof(attr));
+			attr.size = sizeof(attr);
+			attr.type = type;
+			attr.config = config;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+			return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+		}
+
+		static std::uint64_t cache_miss(std::uint64_t cache) {
+			return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		}
+#endif
+
+		hardware_counters() {
+#ifdef XP_HAS_PERF_EVENTS
+			fds[hardware_event::cycles] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+			fds[hardware_event::instructions] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+			fds[hardware_event::l1d_misses] = open(PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_L1D));
+			fds[hardware_event::llc_misses] = open(PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_LL));
+			fds[hardware_event::branch_misses] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+#else
+			for (auto& fd : fds) fd = -1;
+#endif
+		}
+
+	public:
+		~hardware_counters() {
+#ifdef XP_HAS_PERF_EVENTS
+			for (auto fd : fds) {
+				if (fd >= 0) close(fd);
+			}
+#endif
+		}
+
+		hardware_counters(const hardware_counters&) = delete;
+		hardware_counters& operator=(const hardware_counters&) = delete;
+
+		static const hardware_counters& local() {
+			static thread_local hardware_counters instance;
+			return instance;
+		}
+
+		bool available(hardware_event::events e) const {
+			return fds[e] >= 0;
+		}
+
+		// Returns false when the event is not available.
+		// The value is scaled when the kernel multiplexed the counters.
+		bool read(hardware_event::events e, std::uint64_t& value) const {
+#ifdef XP_HAS_PERF_EVENTS
+			std::uint64_t buf[3]; // value, time enabled, time running
+			if (fds[e] < 0 || ::read(fds[e], buf, sizeof(buf)) != sizeof(buf))
+				return false;
+			value = (buf[2] == 0 || buf[1] == buf[2]) ? buf[0] : static_cast<std::uint64_t>(double(buf[0]) * buf[1] / buf[2]);
+			return true;
+#else
+			(void)e;
+			(void)value;
+			return false;
+#endif
+		}
+	};
+
+	struct event_counts {
+		std::uint64_t values[hardware_event::n];
+		unsigned available; // bitmask of the available events
+
+		event_counts() : values(), available(0) {}
+
+		bool has(hardware_event::events e) const {
+			return (available & (1u << e)) != 0;
+		}
+		std::uint64_t operator[](hardware_event::events e) const {
+			return values[e];
+		}
+
+		// instructions per cycle, or 0 when unknown.
+		double ipc() const {
+			if (!has(hardware_event::cycles) || !has(hardware_event::instructions) || values[hardware_event::cycles] == 0)
+				return 0.;
+			return double(values[hardware_event::instructions]) / values[hardware_event::cycles];
+		}
+
+		event_counts& operator+=(const event_counts& x) {
+			for (int e = 0; e != hardware_event::n; ++e)
+				values[e] += x.values[e];
+			available &= x.available;
+			return *this;
+		}
+		inline friend event_counts operator-(const event_counts& x, const event_counts& y) {
+			event_counts r;
+			for (int e = 0; e != hardware_event::n; ++e)
+				r.values[e] = x.values[e] - y.values[e];
+			r.available = x.available & y.available;
+			return r;
+		}
+
+		inline friend std::ostream& operator<<(std::ostream& os, const event_counts& x) {
+			const char* sep = "";
+			for (int e = 0; e != hardware_event::n; ++e) {
+				auto ev = static_cast<hardware_event::events>(e);
+				os << sep << hardware_event::name(ev) << ": ";
+				if (x.has(ev)) os << x.values[e];
+				else os << "n/a";
+				sep = ", ";
+			}
+			return os;
+		}
+	};
+
+	inline event_counts read_hardware_counters() {
+		auto& counters = hardware_counters::local();
+		event_counts r;
+		for (int e = 0; e != hardware_event::n; ++e) {
+			auto ev = static_cast<hardware_event::events>(e);
+			if (counters.read(ev, r.values[e]))
+				r.available |= 1u << e;
+		}
+		return r;
+	}
+
+	// Same interface as timer but reports the hardware events of the calling thread.
+	class counting_timer {
+		event_counts since;
+
+	public:
+		counting_timer() : since(read_hardware_counters()) {}
+
+		void reset() {
+			since = read_hardware_counters();
+		}
+
+		event_counts elapsed() const {
+			return read_hardware_counters() - since;
+		}
+	};
+
+	// A Chrono whose ticks are cpu cycles of the calling thread when the perf events are available,
+	// reference cycles of the time stamp counter otherwise and, as a last resort, nanoseconds.
+	// run_benchmark reports its durations in ticks, its batches being calibrated on the steady clock.
+	class cycle_clock {
+	public:
+		typedef std::int64_t rep;
+		typedef std::ratio<1> period; // a tick is not a second, do not duration_cast.
+		typedef std::chrono::duration<rep, period> duration;
+		typedef std::chrono::time_point<cycle_clock> time_point;
+
+		static const bool is_steady = true;
+
+		enum sources { perf_events, rdtsc, steady };
+
+		static sources source() {
+			if (hardware_counters::local().available(hardware_event::cycles))
+				return perf_events;
+#ifdef XP_HAS_RDTSC
+			return rdtsc;
+#else
+			return steady;
+#endif
+		}
+
+		static time_point now() {
+			std::uint64_t cycles;
+			if (hardware_counters::local().read(hardware_event::cycles, cycles))
+				return time_point {duration {static_cast<rep>(cycles)}};
+#ifdef XP_HAS_RDTSC
+			return time_point {duration {static_cast<rep>(__rdtsc())}};
+#else
+			auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch());
+			return time_point {duration {ns.count()}};
+#endif
+		}
+	};
+
+	template<>
+	struct ticks_are_time<cycle_clock> : std::false_type {};
+
+	// The sizes, in bytes, of the data caches of the first cpu.
+	// On Linux, they are read from sysfs. Elsewhere, or when they cannot be read,
+	// they are guessed from common hardware.
+	struct cache_sizes {
+		std::size_t l1d;
+		std::size_t l2;
+		std::size_t l3;
+
+		static const cache_sizes& local() {
+			static const cache_sizes instance = detect();
+			return instance;
+		}
+
+		// the level of the memory hierarchy in which a working set of the given size fits.
+		const char* regime(std::size_t bytes) const {
+			if (bytes <= l1d) return "L1";
+			if (bytes <= l2) return "L2";
+			if (bytes <= l3) return "L3";
+			return "DRAM";
+		}
+
+	private:
+		static cache_sizes detect() {
+			cache_sizes r = {32 * 1024, 256 * 1024, 8 * 1024 * 1024};
+#if defined(__linux__)
+			for (int index = 0; index != 8; ++index) {
+				std::string dir = "/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(index) + "/";
+				std::ifstream level(dir + "level"), type(dir + "type"), size(dir + "size");
+				int l;
+				std::string t;
+				std::size_t k;
+				char unit = 'K';
+				if (!(level >> l) || !(type >> t) || !(size >> k)) break;
+				size >> unit;
+				std::size_t bytes = k * (unit == 'M' ? 1024 * 1024 : unit == 'K' ? 1024 : 1);
+				if (t == "Instruction") continue;
+				if (l == 1) r.l1d = bytes;
+				else if (l == 2) r.l2 = bytes;
+				else if (l == 3) r.l3 = bytes;
+			}
+#endif
+			return r;
+		}
+	};
+
+} // namespace xp
+
+#endif __HARDWARE_COUNTERS_H__
@@ -1,10 +1,63 @@
 #include <algorithm>
+#include <mutex>
+#include <vector>
 
 #include "instrumented.h"
 
-int xp::instrumented_base::counts[];
+namespace {
+	struct shard_registry {
+		std::mutex m;
+		std::vector<xp::instrumented_base::shard*> shards;
+		std::vector<xp::instrumented_base::shard*> released;
+	};
+
+	// leaked on purpose, the shards may be released after the static destructors ran.
+	shard_registry& registry() {
+		static shard_registry* instance = new shard_registry;
+		return *instance;
+	}
+}
+
+xp::instrumented_base::counters xp::instrumented_base::counts;
 const char* xp::instrumented_base::names[] = {"default_construct", "construct", "copy_construct", "move_construct", "copy_assign", "move_assign", "equal", "compare", "destruct"};
 
 void xp::instrumented_base::reset() {
-	std::fill(counts, counts + n, 0);
-}
\ No newline at end of file
+	auto& r = registry();
+	std::lock_guard<std::mutex> lock(r.m);
+	for (auto p : r.shards) {
+		for (auto& x : p->values)
+			x.store(0, std::memory_order_relaxed);
+	}
+}
+
+xp::instrumented_base::operation_counts xp::instrumented_base::snapshot() {
+	auto& r = registry();
+	operation_counts counts;
+	std::lock_guard<std::mutex> lock(r.m);
+	for (auto p : r.shards) {
+		for (int op = 0; op != n; ++op)
+			counts.values[op] += p->values[op].load(std::memory_order_relaxed);
+	}
+	return counts;
+}
+
+xp::instrumented_base::shard* xp::instrumented_base::acquire_shard() {
+	auto& r = registry();
+	std::lock_guard<std::mutex> lock(r.m);
+	if (!r.released.empty()) {
+		auto p = r.released.back();
+		r.released.pop_back();
+		return p;
+	}
+	auto p = new shard;
+	for (auto& x : p->values)
+		x.store(0, std::memory_order_relaxed);
+	r.shards.push_back(p);
+	return p;
+}
+
+void xp::instrumented_base::release_shard(shard* p) {
+	auto& r = registry();
+	std::lock_guard<std::mutex> lock(r.m);
+	r.released.push_back(p);
+}
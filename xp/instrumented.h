@@ -1,16 +1,77 @@
 #ifndef __INSTRUMENTED_H__
 #define __INSTRUMENTED_H__
 
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
 #include "fakeconcepts.h"
 
 namespace xp {
 
+	// The counters are 64 bits, sharded per thread and aggregated on read,
+	// so that counting from several threads neither loses counts nor serializes on a cache line.
 	struct instrumented_base {
 		enum operations { default_construct, construct, copy_construct, move_construct, copy_assign, move_assign, equal, compare, destruct, n };
-		static int counts[n];
+
+		struct operation_counts {
+			std::uint64_t values[n];
+
+			operation_counts() : values() {}
+
+			std::uint64_t operator[](operations op) const {
+				return values[op];
+			}
+
+			inline friend operation_counts operator-(const operation_counts& x, const operation_counts& y) {
+				operation_counts r;
+				for (int op = 0; op != n; ++op)
+					r.values[op] = x.values[op] - y.values[op];
+				return r;
+			}
+		};
+
+		// aggregates the shards on each read.
+		struct counters {
+			std::uint64_t operator[](operations op) const {
+				return snapshot()[op];
+			}
+		};
+
+		static counters counts;
 		static const char* names[n];
 
+		// must not be called while other threads are counting, use snapshot instead.
 		static void reset();
+		static operation_counts snapshot();
+
+		static void increment(operations op) {
+			// only the owning thread writes in its shard, so there is no need for an atomic increment.
+			auto& x = local_shard().values[op];
+			x.store(x.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		}
+
+		struct shard {
+			std::atomic<std::uint64_t> values[n];
+			char padding[64]; // avoid false sharing with the next shard
+		};
+
+	private:
+		// the shards are never freed, a shard released by an exiting thread keeps its counts
+		// and is reused by the next thread.
+		static shard* acquire_shard();
+		static void release_shard(shard* p);
+
+		struct shard_handle {
+			shard* p;
+			shard_handle() : p(acquire_shard()) {}
+			~shard_handle() { release_shard(p); }
+		};
+
+		static shard& local_shard() {
+			static thread_local shard_handle handle;
+			return *handle.p;
+		}
 	};
 
 
@@ -22,39 +83,39 @@ namespace xp {
 
 		// conversion
 		instrumented(T const& v) : value(v) {
-			++counts[construct];
+			increment(construct);
 		}
 
 		// Semiregular
 		instrumented() : value() {
-			++counts[default_construct];
+			increment(default_construct);
 		}
 
 		instrumented(instrumented const& x) : value(x.value) {
-			++counts[copy_construct];
+			increment(copy_construct);
 		}
 		instrumented(instrumented&& x) noexcept : value(std::move_if_noexcept(x.value)) {
-			++counts[move_construct];
+			increment(move_construct);
 		}
 
 		~instrumented() {
-			++counts[destruct];
+			increment(destruct);
 		}
 
 		instrumented& operator=(instrumented const& x) {
-			++counts[copy_assign];
+			increment(copy_assign);
 			value = x.value;
 			return *this;
 		}
 		instrumented& operator=(instrumented&& x) {
-			++counts[move_assign];
+			increment(move_assign);
 			value = std::move(x.value);
 			return *this;
 		}
 
 		// Regular
 		inline friend bool operator==(instrumented const& x, instrumented const& y) {
-			++counts[equal];
+			increment(equal);
 			return x.value == y.value;
 		}
 		inline friend bool operator!=(instrumented const& x, instrumented const& y) {
@@ -63,7 +124,7 @@ namespace xp {
 
 		// TotallyOrdered
 		inline friend bool operator<(instrumented const& x, instrumented const& y) {
-			++counts[compare];
+			increment(compare);
 			return x.value < y.value;
 		}
 		inline friend bool operator <=(instrumented const& x, instrumented const& y) {
@@ -1,23 +1,43 @@
 #include <algorithm>
+#include <cstring>
 #include <exception>
 #include <iostream>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "report.h"
 #include "tests\testbench.h"
 
 using namespace std;
 
 testing_bench testing_bench::instance;
 
+static bool starts_with(const string& s, const char* prefix) {
+	return s.compare(0, strlen(prefix), prefix) == 0;
+}
+
 int main(int argc, char* argv[])
 try {
+	// options:
+	//   --json=<file>      writes the benchmark results as JSON
+	//   --csv=<file>       writes the benchmark results as CSV
+	//   --baseline=<file>  compares the benchmark results to a previous run and fails on regressions
+	string json, csv, baseline;
+	vector<const char*> names;
+	for (auto first = argv + 1, last = argv + argc; first != last; ++first) {
+		string arg = *first;
+		if (starts_with(arg, "--json=")) json = arg.substr(7);
+		else if (starts_with(arg, "--csv=")) csv = arg.substr(6);
+		else if (starts_with(arg, "--baseline=")) baseline = arg.substr(11);
+		else names.push_back(*first);
+	}
+
 	size_t pass = 0, fail = 0;
-	if (argc > 1) {
+	if (!names.empty()) {
 		// run the specified fixtures in the requested order
-		for (auto first = argv + 1, last = argv + argc; first != last; ++first) {
-			testing_bench::run(*first, pass, fail);
+		for (auto name : names) {
+			testing_bench::run(name, pass, fail);
 		}
 	} else {
 		// run all fixtures
@@ -31,7 +51,18 @@ try {
 		cerr << "ERROR, no test to run" << endl;
 	}
 
-	cin.get();
+	auto& report = xp::benchmark_report::global();
+	if (!json.empty()) report.save(json);
+	if (!csv.empty()) report.save(csv);
+	size_t regressions = 0;
+	if (!baseline.empty()) {
+		regressions = xp::print_regressions(cout, xp::compare(xp::benchmark_report::load(baseline), report));
+		if (regressions) cerr << regressions << " REGRESSION(S) PRESENT." << endl;
+	}
+
+	if (json.empty() && csv.empty() && baseline.empty())
+		cin.get();
+	return regressions ? 1 : 0;
 }
 catch(const exception& e) {
 	cerr << "Exception \"" << e.what() << "\" caught!" << endl;
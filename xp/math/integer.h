@@ -152,6 +152,7 @@ namespace xp {
 			void reserve(size_type additional = 1) {
 				if (!p) {
 					p = allocate(additional);
+					*p = 0;
 					header()->capacity = additional;
 				} else {
 					auto cap = unguarded_capacity();
@@ -168,7 +169,8 @@ namespace xp {
 				auto n = x.size();
 				if (n) {
 					p = allocate(n);
-					memcpy(p, x.p, sizeof(unsigned) * n);
+					memcpy(p, x.p, sizeof(unsigned) * (n + 1));
+					header()->capacity = n;
 				}
 			}
 			~integer_storage_t() { deallocate(); }
@@ -218,16 +220,15 @@ namespace xp {
 			const_reverse_iterator crend() const { return rend(); }
 		};
 
+		// the word of x << shift from a word of x and the one below it, 0 < shift < 32.
+		// Without a carry, the words are independent, so transform_backward runs them in blocks.
 		struct lshift {
 			int shift;
-			unsigned carry;
 
 			lshift(int shift) : shift(shift){}
 
-			unsigned operator()(unsigned x) {
-				unsigned r = (x << shift) | carry;
-				carry = x >> (sizeof(unsigned)*8 - shift);
-				return r;
+			unsigned operator()(unsigned x, unsigned lower) const {
+				return (x << shift) | (lower >> (sizeof(unsigned) * 8 - shift));
 			}
 		};
 		struct rshift {
@@ -267,12 +268,7 @@ namespace xp {
 		details::integer_storage_t storage;
 
 		void twice() {
-			if (!storage.empty()) {
-				auto op = details::lshift {1};
-				transform_backward(storage.cbegin(), storage.cend(), storage.cend(), std::ref(op));
-				if (op.carry)
-					storage.push(1);
-			}
+			*this <<= 1;
 		}
 
 	public:
@@ -333,15 +329,22 @@ namespace xp {
 			if (!storage.empty()) {
 				int q = x / (sizeof(unsigned) * 8);
 				int r = x % (sizeof(unsigned) * 8);
-				if (bits(storage.back(), sizeof(unsigned) * 8 - r, r))
-					++q;
-				storage.reserve(q);
-				auto op = details::lshift {r};
-				auto e = transform_backward(storage.cbegin(), storage.cend(), storage.end() + q, std::ref(op));
-				storage.header()->size += q;
-				if (q && op.carry)
-					*e-- = op.carry;
-				std::fill(storage.begin(), e, 0);
+				unsigned top = r ? storage.back() >> (sizeof(unsigned) * 8 - r) : 0;
+				int extra = top ? 1 : 0;
+				storage.reserve(q + extra);
+				auto first = storage.begin();
+				auto last = storage.end();
+				if (r) {
+					transform_backward(first + 1, last, last - 1, last + q, details::lshift {r});
+					first[q] = first[0] << r;
+				}
+				else {
+					std::copy_backward(first, last, last + q);
+				}
+				if (extra)
+					last[q] = top;
+				std::fill(first, first + q, 0u);
+				storage.header()->size += q + extra;
 			}
 			return *this;
 		}
@@ -0,0 +1,92 @@
+#ifndef __OUT_OF_CORE_H__
+#define __OUT_OF_CORE_H__
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "fakeconcepts.h"
+#include "algorithm.h"
+#include "temporary_file.h"
+
+// Algorithms holding at most a memory budget, the rest of their data being spilled to a temporary file.
+// They need temporary_file.cpp to be linked in the program.
+
+namespace xp {
+
+	namespace details {
+
+		// The elements are read in blocks of budget bytes. The full blocks are reversed and spilled to a temporary file,
+		// then mapped back from the last one and folded left to right, so the memory held is a block, whatever the size of the input.
+		template<InputIterator I, BinaryOperation Op>
+		ValueType(I) foldr_input_spilling_nonempty(I first, I last, Op op, std::size_t budget, std::true_type) {
+			typedef ValueType(I) T;
+			const std::size_t n = std::max<std::size_t>(1, budget / sizeof(T));
+			std::vector<T> block;
+			std::unique_ptr<temporary_file> spilled;
+			for (; first != last; ++first) {
+				if (block.size() == n) {
+					if (!spilled) spilled.reset(new temporary_file());
+					std::reverse(block.begin(), block.end());
+					spilled->append(block.data(), n * sizeof(T));
+					block.clear();
+				}
+				else if (block.size() == block.capacity()) {
+					// grows up to the block size only, the input may be short.
+					block.reserve(std::min(n, std::max<std::size_t>(16, 2 * block.capacity())));
+				}
+				block.push_back(*first);
+			}
+
+			T r = block.back();
+			block.pop_back();
+			while (!block.empty()) {
+				r = op(block.back(), r);
+				block.pop_back();
+			}
+			if (!spilled) return r;
+
+			block.shrink_to_fit();
+			for (auto offset = spilled->size(); offset != 0;) {
+				offset -= n * sizeof(T);
+				auto view = spilled->map(offset, n * sizeof(T));
+				auto p = static_cast<const T*>(view.data());
+				for (std::size_t i = 0; i != n; ++i)
+					r = op(p[i], r);
+			}
+			return r;
+		}
+
+		// the elements cannot be written to a file, they are all kept in memory.
+		template<InputIterator I, BinaryOperation Op>
+		ValueType(I) foldr_input_spilling_nonempty(I first, I last, Op op, std::size_t, std::false_type) {
+			return foldr_input_nonempty(first, last, op);
+		}
+
+		template<InputIterator I, typename T, BinaryOperation Op>
+		T foldr_spilling_nonempty(I first, I last, Op op, std::size_t budget, std::input_iterator_tag) {
+			return foldr_input_spilling_nonempty(first, last, op, budget, std::is_trivially_copyable<ValueType(I)>());
+		}
+
+		// the range is folded backward, nothing is held.
+		template<BidirectionalIterator I, typename T, BinaryOperation Op>
+		T foldr_spilling_nonempty(I first, I last, Op op, std::size_t, std::bidirectional_iterator_tag) {
+			return foldr_nonempty<I, T>(first, last, op, std::bidirectional_iterator_tag());
+		}
+
+	} // namespace details
+
+	// On input iterators, at most budget bytes of trivially copyable elements are kept in memory,
+	// the others are spilled to a temporary file. Throws std::runtime_error when the file cannot be written.
+	template<InputIterator I, typename T, BinaryOperation Op>
+	T foldr(I first, I last, Op op, const T& z, std::size_t budget) {
+		if (first == last) return z;
+		return details::foldr_spilling_nonempty<I, T>(first, last, op, budget, typename std::iterator_traits<I>::iterator_category());
+	}
+
+} // namespace xp
+
+#endif __OUT_OF_CORE_H__
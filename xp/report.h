@@ -0,0 +1,423 @@
+#ifndef __REPORT_H__
+#define __REPORT_H__
+
+#include <cctype>
+#include <cmath>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmark.h"
+
+// Machine readable benchmark results, keyed by fixture, test and scenario.
+// The results can be written as JSON or CSV, read back, and compared to a baseline.
+
+namespace xp {
+
+	struct benchmark_result {
+		std::string fixture;
+		std::string test;
+		std::string scenario;
+		statistics<std::chrono::duration<double, std::nano>> stats;
+
+		bool same_key(const benchmark_result& x) const {
+			return fixture == x.fixture && test == x.test && scenario == x.scenario;
+		}
+	};
+
+	namespace details {
+
+		// The order of the fields, in the files.
+		struct report_field {
+			const char* name;
+			std::chrono::duration<double, std::nano> statistics<std::chrono::duration<double, std::nano>>::* member;
+		};
+
+		inline const std::vector<report_field>& report_fields() {
+			typedef statistics<std::chrono::duration<double, std::nano>> S;
+			static const std::vector<report_field> fields {
+				{"min_ns", &S::min},
+				{"max_ns", &S::max},
+				{"mean_ns", &S::mean},
+				{"stddev_ns", &S::stddev},
+				{"median_ns", &S::median},
+				{"mad_ns", &S::mad},
+				{"p90_ns", &S::p90},
+				{"p99_ns", &S::p99},
+				{"ci_lower_ns", &S::ci_lower},
+				{"ci_upper_ns", &S::ci_upper},
+			};
+			return fields;
+		}
+
+		inline void write_json_string(std::ostream& os, const std::string& s) {
+			os << '"';
+			for (char c : s) {
+				switch (c) {
+				case '"': os << "\\\""; break;
+				case '\\': os << "\\\\"; break;
+				case '\n': os << "\\n"; break;
+				case '\t': os << "\\t"; break;
+				default: os << c;
+				}
+			}
+			os << '"';
+		}
+
+		inline void write_csv_string(std::ostream& os, const std::string& s) {
+			if (s.find_first_of(",\"\n") == std::string::npos) {
+				os << s;
+				return;
+			}
+			os << '"';
+			for (char c : s) {
+				if (c == '"') os << '"';
+				os << c;
+			}
+			os << '"';
+		}
+
+		// Minimal reader for the JSON written by benchmark_report: an array of flat objects.
+		class json_reader {
+			std::istream& is;
+
+			void fail(const char* what) {
+				throw std::runtime_error(std::string("invalid benchmark report: ") + what);
+			}
+			char peek() {
+				is >> std::ws;
+				return static_cast<char>(is.peek());
+			}
+			void expect(char c) {
+				if (peek() != c) fail("unexpected character");
+				is.get();
+			}
+
+		public:
+			json_reader(std::istream& is) : is(is) {}
+
+			std::string read_string() {
+				expect('"');
+				std::string s;
+				for (;;) {
+					int c = is.get();
+					if (c == EOF) fail("unterminated string");
+					if (c == '"') return s;
+					if (c == '\\') {
+						c = is.get();
+						switch (c) {
+						case 'n': c = '\n'; break;
+						case 't': c = '\t'; break;
+						case EOF: fail("unterminated string");
+						}
+					}
+					s += static_cast<char>(c);
+				}
+			}
+
+			double read_number() {
+				peek();
+				double x;
+				if (!(is >> x)) fail("number expected");
+				return x;
+			}
+
+			template<typename F>
+			void read_array(F f) {
+				expect('[');
+				if (peek() == ']') {
+					is.get();
+					return;
+				}
+				for (;;) {
+					f();
+					if (peek() == ']') break;
+					expect(',');
+				}
+				is.get();
+			}
+
+			// f is called with the name of each member, and must consume its value.
+			template<typename F>
+			void read_object(F f) {
+				expect('{');
+				if (peek() == '}') {
+					is.get();
+					return;
+				}
+				for (;;) {
+					auto name = read_string();
+					expect(':');
+					f(name);
+					if (peek() == '}') break;
+					expect(',');
+				}
+				is.get();
+			}
+
+			bool at_string() {
+				return peek() == '"';
+			}
+		};
+
+		inline std::vector<std::string> split_csv_line(const std::string& line) {
+			std::vector<std::string> cells(1);
+			bool quoted = false;
+			for (std::size_t i = 0; i != line.size(); ++i) {
+				char c = line[i];
+				if (quoted) {
+					if (c != '"') cells.back() += c;
+					else if (i + 1 != line.size() && line[i + 1] == '"') cells.back() += line[++i];
+					else quoted = false;
+				} else if (c == '"') {
+					quoted = true;
+				} else if (c == ',') {
+					cells.emplace_back();
+				} else if (c != '\r') {
+					cells.back() += c;
+				}
+			}
+			return cells;
+		}
+
+	} // namespace details
+
+	class benchmark_report {
+		std::vector<benchmark_result> results;
+
+	public:
+		typedef std::vector<benchmark_result>::const_iterator const_iterator;
+
+		// the report filled by the benches.
+		static benchmark_report& global() {
+			static benchmark_report instance;
+			return instance;
+		}
+
+		template<typename D>
+		requires(D is Duration)
+		void add(std::string fixture, std::string test, std::string scenario, const statistics<D>& s) {
+			typedef std::chrono::duration<double, std::nano> F;
+			benchmark_result r;
+			r.fixture = std::move(fixture);
+			r.test = std::move(test);
+			r.scenario = std::move(scenario);
+			r.stats.n = s.n;
+			r.stats.outliers = s.outliers;
+			r.stats.min = F(s.min);
+			r.stats.max = F(s.max);
+			r.stats.mean = F(s.mean);
+			r.stats.stddev = F(s.stddev);
+			r.stats.median = F(s.median);
+			r.stats.mad = F(s.mad);
+			r.stats.p90 = F(s.p90);
+			r.stats.p99 = F(s.p99);
+			r.stats.ci_lower = F(s.ci_lower);
+			r.stats.ci_upper = F(s.ci_upper);
+			add(std::move(r));
+		}
+
+		// a result with the same key replaces the previous one.
+		void add(benchmark_result r) {
+			for (auto& x : results) {
+				if (x.same_key(r)) {
+					x = std::move(r);
+					return;
+				}
+			}
+			results.push_back(std::move(r));
+		}
+
+		const benchmark_result* find(const benchmark_result& key) const {
+			for (auto& x : results) {
+				if (x.same_key(key)) return &x;
+			}
+			return nullptr;
+		}
+
+		const_iterator begin() const { return results.begin(); }
+		const_iterator end() const { return results.end(); }
+		std::size_t size() const { return results.size(); }
+		bool empty() const { return results.empty(); }
+
+		void write_json(std::ostream& os) const {
+			using namespace details;
+			auto precision = os.precision(std::numeric_limits<double>::max_digits10);
+			os << '[';
+			const char* sep = "\n";
+			for (auto& r : results) {
+				os << sep << "  {\"fixture\": ";
+				write_json_string(os, r.fixture);
+				os << ", \"test\": ";
+				write_json_string(os, r.test);
+				os << ", \"scenario\": ";
+				write_json_string(os, r.scenario);
+				os << ", \"n\": " << r.stats.n << ", \"outliers\": " << r.stats.outliers;
+				for (auto& f : report_fields())
+					os << ", \"" << f.name << "\": " << (r.stats.*f.member).count();
+				os << '}';
+				sep = ",\n";
+			}
+			os << "\n]\n";
+			os.precision(precision);
+		}
+
+		void write_csv(std::ostream& os) const {
+			using namespace details;
+			auto precision = os.precision(std::numeric_limits<double>::max_digits10);
+			os << "fixture,test,scenario,n,outliers";
+			for (auto& f : report_fields())
+				os << ',' << f.name;
+			os << '\n';
+			for (auto& r : results) {
+				write_csv_string(os, r.fixture);
+				os << ',';
+				write_csv_string(os, r.test);
+				os << ',';
+				write_csv_string(os, r.scenario);
+				os << ',' << r.stats.n << ',' << r.stats.outliers;
+				for (auto& f : report_fields())
+					os << ',' << (r.stats.*f.member).count();
+				os << '\n';
+			}
+			os.precision(precision);
+		}
+
+		static benchmark_report read_json(std::istream& is) {
+			typedef std::chrono::duration<double, std::nano> F;
+			using namespace details;
+
+			benchmark_report report;
+			json_reader reader(is);
+			reader.read_array([&]() {
+				benchmark_result r {};
+				reader.read_object([&](const std::string& name) {
+					if (name == "fixture") r.fixture = reader.read_string();
+					else if (name == "test") r.test = reader.read_string();
+					else if (name == "scenario") r.scenario = reader.read_string();
+					else if (reader.at_string()) reader.read_string(); // unknown member
+					else {
+						double x = reader.read_number();
+						if (name == "n") r.stats.n = static_cast<std::size_t>(x);
+						else if (name == "outliers") r.stats.outliers = static_cast<std::size_t>(x);
+						for (auto& f : report_fields()) {
+							if (name == f.name) r.stats.*f.member = F(x);
+						}
+					}
+				});
+				report.add(std::move(r));
+			});
+			return report;
+		}
+
+		static benchmark_report read_csv(std::istream& is) {
+			typedef std::chrono::duration<double, std::nano> F;
+			using namespace details;
+
+			benchmark_report report;
+			std::string line;
+			if (!std::getline(is, line))
+				return report;
+			auto header = split_csv_line(line);
+			while (std::getline(is, line)) {
+				if (line.empty() || line == "\r") continue;
+				auto cells = split_csv_line(line);
+				if (cells.size() != header.size())
+					throw std::runtime_error("invalid benchmark report: wrong number of cells");
+				benchmark_result r {};
+				for (std::size_t i = 0; i != cells.size(); ++i) {
+					auto& name = header[i];
+					if (name == "fixture") r.fixture = cells[i];
+					else if (name == "test") r.test = cells[i];
+					else if (name == "scenario") r.scenario = cells[i];
+					else if (name == "n") r.stats.n = std::stoul(cells[i]);
+					else if (name == "outliers") r.stats.outliers = std::stoul(cells[i]);
+					for (auto& f : report_fields()) {
+						if (name == f.name) r.stats.*f.member = F(std::stod(cells[i]));
+					}
+				}
+				report.add(std::move(r));
+			}
+			return report;
+		}
+
+		// the format is deduced from the extension of the file.
+		void save(const std::string& path) const {
+			std::ofstream os(path);
+			if (!os) throw std::runtime_error("cannot open " + path);
+			if (path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0) write_csv(os);
+			else write_json(os);
+		}
+
+		// the format is deduced from the content of the file.
+		static benchmark_report load(const std::string& path) {
+			std::ifstream is(path);
+			if (!is) throw std::runtime_error("cannot open " + path);
+			is >> std::ws;
+			if (is.peek() == '[') return read_json(is);
+			return read_csv(is);
+		}
+	};
+
+	struct benchmark_comparison {
+		const benchmark_result* baseline;
+		const benchmark_result* current;
+		double change;     // relative change of the mean, positive when slower.
+		bool significant;
+
+		bool regression() const { return significant && change > 0.; }
+		bool improvement() const { return significant && change < 0.; }
+	};
+
+	// A change is significant when Welch's t statistic exceeds 1.96 (large samples approximation)
+	// and the relative change of the mean exceeds the tolerance.
+	inline std::vector<benchmark_comparison> compare(const benchmark_report& baseline, const benchmark_report& current, double tolerance = .05) {
+		std::vector<benchmark_comparison> r;
+		for (auto& x : current) {
+			auto base = baseline.find(x);
+			if (!base) continue;
+
+			double m0 = base->stats.mean.count();
+			double m1 = x.stats.mean.count();
+			double s0 = base->stats.stddev.count();
+			double s1 = x.stats.stddev.count();
+			double n0 = double(std::max<std::size_t>(base->stats.n, 1));
+			double n1 = double(std::max<std::size_t>(x.stats.n, 1));
+
+			benchmark_comparison c;
+			c.baseline = base;
+			c.current = &x;
+			c.change = m0 != 0. ? (m1 - m0) / m0 : 0.;
+			double error = std::sqrt(s0 * s0 / n0 + s1 * s1 / n1);
+			bool distinct = error != 0. ? std::abs(m1 - m0) / error > 1.96 : m0 != m1;
+			c.significant = distinct && std::abs(c.change) > tolerance;
+			r.push_back(c);
+		}
+		return r;
+	}
+
+	// Prints the significant changes and returns the number of regressions.
+	inline std::size_t print_regressions(std::ostream& os, const std::vector<benchmark_comparison>& comparisons) {
+		std::size_t n = 0;
+		for (auto& c : comparisons) {
+			if (!c.significant) continue;
+			os << (c.regression() ? "REGRESSION " : "improvement ")
+				<< c.current->fixture << '/' << c.current->test << '/' << c.current->scenario << ": "
+				<< std::showpos << std::fixed << std::setprecision(1) << c.change * 100. << '%'
+				<< std::noshowpos << std::defaultfloat << std::setprecision(6)
+				<< " (" << c.baseline->stats.mean.count() << " ns -> " << c.current->stats.mean.count() << " ns)" << std::endl;
+			if (c.regression()) ++n;
+		}
+		return n;
+	}
+
+} // namespace xp
+
+#endif __REPORT_H__
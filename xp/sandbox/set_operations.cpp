@@ -3,8 +3,11 @@
 #include <functional>
 #include <iostream>
 #include <iterator>
+#include <list>
 #include <numeric>
 #include <random>
+#include <string>
+#include <tuple>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -12,6 +15,8 @@
 #include "../algorithm.h"
 #include "../fakeconcepts.h"
 #include "../benchmark.h"
+#include "../report.h"
+#include "../simd.h"
 #include "../tests/testbench.h"
 
 // benchmarking responses from SO
@@ -25,11 +30,11 @@ namespace {
 	template<typename C, class URNG>
 	C sample(C& c, URNG&& g) {
 		const auto n = c.size();
-		const uniform_int_distribution<int> dist(n /4, n / 2);
+		uniform_int_distribution<int> dist(n / 4, n / 2);
 		C r;
 		r.reserve(dist(g));
 		shuffle(c.begin(), c.end(), std::forward<URNG>(g));
-		copy_n(c.cbegin(), c.capacity(), back_inserter(r));
+		copy_n(c.cbegin(), r.capacity(), back_inserter(r));
 		return r;
 	}
 }
@@ -90,10 +95,47 @@ void scenario2(vector<int>& a, vector<int>& b) {
 	}
 }
 
+void reserve_partition(const vector<int>& a, const vector<int>& b, vector<int>& only_a, vector<int>& only_b, vector<int>& both) {
+	only_a.reserve(a.size());
+	only_b.reserve(b.size());
+	both.reserve(std::min(a.size(), b.size()));
+}
+
+// the partition_sets strategies, on sorted vectors.
+void sorted_by_merge(vector<int>& a, vector<int>& b) {
+	vector<int> only_a, only_b, both;
+	reserve_partition(a, b, only_a, only_b, both);
+	details::partition_sets_by_merge(a.cbegin(), a.cend(), b.cbegin(), b.cend(), back_inserter(only_a), back_inserter(only_b), back_inserter(both), less<>());
+}
+
+void sorted_by_galloping(vector<int>& a, vector<int>& b) {
+	vector<int> only_a, only_b, both;
+	reserve_partition(a, b, only_a, only_b, both);
+	details::partition_sets_by_galloping(a.cbegin(), a.cend(), b.cbegin(), b.cend(), back_inserter(only_a), back_inserter(only_b), back_inserter(both), less<>());
+}
+
+void sorted_by_blocks(vector<int>& a, vector<int>& b) {
+	vector<int> only_a, only_b, both;
+	reserve_partition(a, b, only_a, only_b, both);
+	simd::partition_sets(a.data(), a.data() + a.size(), b.data(), b.data() + b.size(), back_inserter(only_a), back_inserter(only_b), back_inserter(both));
+}
+
+void sorted_automatic(vector<int>& a, vector<int>& b) {
+	vector<int> only_a, only_b, both;
+	reserve_partition(a, b, only_a, only_b, both);
+	partition_sets(a.data(), a.data() + a.size(), b.data(), b.data() + b.size(), back_inserter(only_a), back_inserter(only_b), back_inserter(both));
+}
+
+void hashed(vector<int>& a, vector<int>& b) {
+	vector<int> only_a, only_b, both;
+	reserve_partition(a, b, only_a, only_b, both);
+	partition_unsorted_sets(a.cbegin(), a.cend(), b.cbegin(), b.cend(), back_inserter(only_a), back_inserter(only_b), back_inserter(both));
+}
+
 TESTBENCH()
 
 TEST(bench_partition_sets) {
-	const int attempts = 500;
+	const int attempts = 100;
 
 	vector<int> v(50000);
 	iota(begin(v), end(v), 1);
@@ -101,23 +143,44 @@ TEST(bench_partition_sets) {
 	mt19937 rng {1664};
 	auto v1 = sample(v, rng);
 	auto v2 = sample(v, rng);
+	// a few elements, to partition against a large set
+	vector<int> v3(v2.begin(), v2.begin() + v2.size() / 100);
 
-	vector<pair<string, scenario_t>> scenarii {
+	vector<pair<string, scenario_t>> unsorted {
 		make_pair("using sorted vectors", &scenario1),
 		make_pair("using unordered_map", &scenario2),
+		make_pair("partition_unsorted_sets", &hashed),
+	};
+	vector<pair<string, scenario_t>> sorted {
+		make_pair("partition_sets by merge", &sorted_by_merge),
+		make_pair("partition_sets by galloping", &sorted_by_galloping),
+		make_pair("partition_sets by blocks", &sorted_by_blocks),
+		make_pair("partition_sets", &sorted_automatic),
 	};
 
-	for (auto& scenario : scenarii) {
-		measures<microseconds> m;
-		for (int attempt = 0; attempt != attempts; ++attempt) {
-			auto a = v1;
-			auto b = v2;
-
-			timer<high_resolution_clock> w;
-			scenario.second(a, b);
-			m += w.elapsed<microseconds>();
+	for (auto& sizes : {make_pair(string("similar sizes"), &v2), make_pair(string("1:100"), &v3)}) {
+		cout << "  " << sizes.first << " (" << v1.size() << " and " << sizes.second->size() << " elements)" << endl;
+		for (bool presorted : {false, true}) {
+			auto v1_sorted = v1;
+			auto v2_sorted = *sizes.second;
+			if (presorted) {
+				sort(v1_sorted.begin(), v1_sorted.end());
+				sort(v2_sorted.begin(), v2_sorted.end());
+			}
+			for (auto& scenario : presorted ? sorted : unsorted) {
+				samples<microseconds> m;
+				for (int attempt = 0; attempt != attempts; ++attempt) {
+					auto a = v1_sorted;
+					auto b = v2_sorted;
+
+					timer<high_resolution_clock> w;
+					scenario.second(a, b);
+					m += w.elapsed<microseconds>();
+				}
+				cout << "    " << scenario.first << " took an average of " << m.avg().count() << " us." << endl;
+				REPORT(sizes.first + "/" + scenario.first, summarize(m));
+			}
 		}
-		cout << "  " << scenario.first << " took an average of " << m.avg().count() << " us." << endl;
 	}
 }
 
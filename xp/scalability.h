@@ -0,0 +1,166 @@
+#ifndef __SCALABILITY_H__
+#define __SCALABILITY_H__
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#endif
+
+#include "fakeconcepts.h"
+#include "benchmark.h"
+
+// Runs the same body on an increasing number of threads, each pinned to its own core,
+// to measure the throughput, the latency and the parallel efficiency.
+
+namespace xp {
+
+	// Pins the calling thread to the index-th core available to the process.
+	// Returns false when the platform does not support it or when there are not enough cores.
+	inline bool pin_current_thread(unsigned index) {
+#if defined(__linux__)
+		cpu_set_t available;
+		if (sched_getaffinity(0, sizeof(available), &available) != 0) return false;
+		for (int core = 0; core != CPU_SETSIZE; ++core) {
+			if (!CPU_ISSET(core, &available) || index-- != 0) continue;
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(core, &set);
+			return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+		}
+		return false;
+#elif defined(_WIN32)
+		DWORD_PTR process, system;
+		if (!GetProcessAffinityMask(GetCurrentProcess(), &process, &system)) return false;
+		for (unsigned core = 0; core != sizeof(DWORD_PTR) * 8; ++core) {
+			if (!(process & (DWORD_PTR(1) << core)) || index-- != 0) continue;
+			return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << core) != 0;
+		}
+		return false;
+#else
+		(void)index;
+		return false;
+#endif
+	}
+
+	// Blocks the threads until all the parties have arrived.
+	class start_barrier {
+		std::mutex m;
+		std::condition_variable cv;
+		std::size_t count;
+
+	public:
+		explicit start_barrier(std::size_t parties) : count(parties) {}
+
+		start_barrier(const start_barrier&) = delete;
+		start_barrier& operator=(const start_barrier&) = delete;
+
+		void arrive_and_wait() {
+			std::unique_lock<std::mutex> lock(m);
+			if (--count == 0) {
+				cv.notify_all();
+				return;
+			}
+			cv.wait(lock, [this]() { return count == 0; });
+		}
+	};
+
+	struct scalability_point {
+		unsigned threads;
+		double throughput;  // executions per second, all threads together
+		double speedup;     // relative to the throughput of the first point
+		double efficiency;  // speedup per thread, relative to the first point
+		statistics<std::chrono::duration<double, std::nano>> latency;       // of one execution, all threads together
+		std::vector<std::chrono::duration<double, std::nano>> thread_medians; // the median latency of each thread
+	};
+
+	// 1, 2, 4, ... up to max, included.
+	inline std::vector<unsigned> thread_counts(unsigned max = std::max(1u, std::thread::hardware_concurrency())) {
+		std::vector<unsigned> r;
+		for (unsigned t = 1; t < max; t += t)
+			r.push_back(t);
+		r.push_back(max);
+		return r;
+	}
+
+	// Each thread works on its own copy of f. The batch size is calibrated on a single thread
+	// then every thread samples options.sample_count batches.
+	template<typename C, Function F>
+	requires(C is Chrono)
+	std::vector<scalability_point> run_scalability(F f, const std::vector<unsigned>& counts = thread_counts(), const benchmark_options& options = benchmark_options()) {
+		typedef std::chrono::duration<double, std::nano> D;
+		static_assert(ticks_are_time<C>::value, "the latencies and the throughput are reported in time");
+
+		long n = calibrate<C>(f, std::chrono::duration_cast<typename C::duration>(options.target));
+		std::vector<scalability_point> points;
+		for (auto threads : counts) {
+			std::vector<samples<D>> latencies(threads);
+			std::vector<std::thread> workers;
+			start_barrier barrier(threads + 1);
+			for (unsigned k = 0; k != threads; ++k) {
+				workers.emplace_back([&, k]() {
+					pin_current_thread(k);
+					F g = f;
+					for (int w = 0; w != options.warmup; ++w) {
+						for (long i = 0; i != n; ++i)
+							details::invoke_observed(g);
+					}
+					auto& s = latencies[k];
+					s.reserve(options.sample_count);
+					barrier.arrive_and_wait();
+					for (int j = 0; j != options.sample_count; ++j) {
+						timer<C> t;
+						for (long i = 0; i != n; ++i)
+							details::invoke_observed(g);
+						s += t.template elapsed<D>() / double(n);
+					}
+				});
+			}
+			barrier.arrive_and_wait();
+			timer<C> wall;
+			for (auto& w : workers)
+				w.join();
+			auto elapsed = wall.template elapsed<std::chrono::duration<double>>();
+
+			scalability_point p;
+			p.threads = threads;
+			p.throughput = double(threads) * options.sample_count * n / elapsed.count();
+			samples<D> all;
+			for (auto& s : latencies) {
+				p.thread_medians.push_back(s.median());
+				for (auto d : s) all += d;
+			}
+			p.latency = summarize(all, options.outlier_threshold);
+			p.speedup = points.empty() ? 1. : p.throughput / points.front().throughput;
+			p.efficiency = points.empty() ? 1. : p.speedup * points.front().threads / threads;
+			points.push_back(std::move(p));
+		}
+		return points;
+	}
+
+	inline void print_scalability(std::ostream& os, const std::vector<scalability_point>& points) {
+		for (auto& p : points) {
+			os << "    " << p.threads << " thread(s): " << p.throughput << " executions/s, speedup " << p.speedup
+				<< ", efficiency " << p.efficiency << ", latency median " << p.latency.median.count() << " ns, p99 " << p.latency.p99.count() << " ns" << std::endl;
+		}
+	}
+
+} // namespace xp
+
+#endif __SCALABILITY_H__
@@ -0,0 +1,1043 @@
+#ifndef __SIMD_H__
+#define __SIMD_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define XP_HAS_X86_SIMD
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <immintrin.h>
+#endif
+#endif
+
+// SIMD kernels for contiguous ranges of arithmetic values, selected at runtime
+// among the instruction sets supported by the cpu. Each kernel has a scalar fallback,
+// used on other architectures and for the elements left over by the vector loop.
+//
+// The kernels are compiled for their instruction set with the target attribute on GCC and Clang,
+// MSVC does not require it, so the rest of the program does not need to be compiled for AVX2.
+
+#if defined(XP_HAS_X86_SIMD) && !defined(_MSC_VER)
+#define XP_TARGET(isa) __attribute__((target(isa)))
+#else
+#define XP_TARGET(isa)
+#endif
+
+namespace xp {
+	namespace simd {
+
+		struct instruction_set {
+			enum sets { scalar, sse41, avx2, n };
+
+			static const char* name(sets s) {
+				static const char* names[n] = {"scalar", "sse4.1", "avx2"};
+				return names[s];
+			}
+
+			// the best instruction set supported by the cpu and the os.
+			static sets best() {
+				static const sets instance = detect();
+				return instance;
+			}
+
+			// s, or the best supported instruction set when s is not supported.
+			static sets clamp(sets s) {
+				return s < best() ? s : best();
+			}
+
+		private:
+			static sets detect() {
+#if defined(XP_HAS_X86_SIMD) && defined(_MSC_VER)
+				int info[4];
+				__cpuid(info, 0);
+				int ids = info[0];
+				__cpuid(info, 1);
+				bool sse41 = (info[2] & (1 << 19)) != 0;
+				bool osxsave = (info[2] & (1 << 27)) != 0;
+				bool avx = (info[2] & (1 << 28)) != 0;
+				bool avx2 = false;
+				if (ids >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6) {
+					__cpuidex(info, 7, 0);
+					avx2 = (info[1] & (1 << 5)) != 0;
+				}
+				return avx2 ? instruction_set::avx2 : sse41 ? instruction_set::sse41 : scalar;
+#elif defined(XP_HAS_X86_SIMD)
+				__builtin_cpu_init();
+				if (__builtin_cpu_supports("avx2")) return instruction_set::avx2;
+				if (__builtin_cpu_supports("sse4.1")) return instruction_set::sse41;
+				return scalar;
+#else
+				return scalar;
+#endif
+			}
+		};
+
+		// The types compared lane by lane. Floating point lanes are compared as with ==,
+		// so NaN is never found and -0. is found as 0.
+		template<typename T>
+		struct is_vectorizable : std::integral_constant<bool,
+			(std::is_integral<T>::value && !std::is_same<T, bool>::value) || std::is_same<T, float>::value || std::is_same<T, double>::value> {};
+
+		// True when I is a pointer to a vectorizable type, and T is that type.
+		template<typename I, typename T>
+		struct is_searchable : std::false_type {};
+
+		template<typename U, typename T>
+		struct is_searchable<U*, T> : std::integral_constant<bool,
+			is_vectorizable<typename std::remove_cv<U>::type>::value && std::is_same<typename std::remove_cv<U>::type, T>::value> {};
+
+		namespace details {
+
+			inline unsigned lowest_bit(std::uint32_t mask) {
+#if defined(_MSC_VER)
+				unsigned long index;
+				_BitScanForward(&index, mask);
+				return index;
+#else
+				return __builtin_ctz(mask);
+#endif
+			}
+
+			inline unsigned highest_bit(std::uint32_t mask) {
+#if defined(_MSC_VER)
+				unsigned long index;
+				_BitScanReverse(&index, mask);
+				return index;
+#else
+				return 31 - __builtin_clz(mask);
+#endif
+			}
+
+			template<typename T>
+			const T* find_scalar(const T* first, const T* last, T val) {
+				for (; first != last; ++first) {
+					if (*first == val) return first;
+				}
+				return last;
+			}
+
+			template<typename T>
+			const T* find_backward_scalar(const T* first, const T* last, T val) {
+				auto it = last;
+				while (it != first) {
+					if (*--it == val) return it;
+				}
+				return last;
+			}
+
+			template<typename T>
+			const T* find_not_scalar(const T* first, const T* last, T val) {
+				for (; first != last; ++first) {
+					if (!(*first == val)) return first;
+				}
+				return last;
+			}
+
+			template<typename T, typename F>
+			void for_each_equal_scalar(const T* first, const T* last, T val, F& f) {
+				for (; first != last; ++first) {
+					if (*first == val) f(first);
+				}
+			}
+
+			// Partitions the sorted sets a and b, the elements of their first blocks being already matched
+			// when their bit is set in ma or mb: the matched elements of a are written to both, the ones of b are skipped.
+			template<typename T, typename O1, typename O2, typename O3>
+			void partition_sets_scalar(const T* a, const T* la, const T* b, const T* lb, std::uint32_t ma, std::uint32_t mb, O1& only1, O2& only2, O3& both) {
+				while (a != la && b != lb) {
+					if (ma & 1) {
+						*both = *a;
+						++both;
+						++a;
+						ma >>= 1;
+					}
+					else if (mb & 1) {
+						++b;
+						mb >>= 1;
+					}
+					else if (*a < *b) {
+						*only1 = *a;
+						++only1;
+						++a;
+						ma >>= 1;
+					}
+					else if (*b < *a) {
+						*only2 = *b;
+						++only2;
+						++b;
+						mb >>= 1;
+					}
+					else {
+						*both = *a;
+						++both;
+						++a;
+						++b;
+						ma >>= 1;
+						mb >>= 1;
+					}
+				}
+				for (; a != la; ++a, ma >>= 1) {
+					if (ma & 1) {
+						*both = *a;
+						++both;
+					}
+					else {
+						*only1 = *a;
+						++only1;
+					}
+				}
+				for (; b != lb; ++b, mb >>= 1) {
+					if (mb & 1) continue;
+					*only2 = *b;
+					++only2;
+				}
+			}
+
+			template<typename T>
+			void reverse_scalar(T* first, T* last) {
+				while (last - first > 1) {
+					--last;
+					std::swap(*first, *last);
+					++first;
+				}
+			}
+
+			// counts the elements of [first, last) different from their predecessor, first[-1] being valid.
+			template<typename T>
+			std::size_t count_adjacent_differences_scalar(const T* first, const T* last) {
+				std::size_t r = 0;
+				for (; first != last; ++first)
+					r += !(first[0] == first[-1]);
+				return r;
+			}
+
+			// continues the encoding of a run started at start, whose pair is out[-1], from first, first[-1] being valid.
+			template<typename T, typename N>
+			std::pair<N, T>* run_length_encode_scalar(const T* start, const T* first, const T* last, std::pair<N, T>* out) {
+				for (; first != last; ++first) {
+					if (first[0] == first[-1]) continue;
+					out[-1].first = N(first - start);
+					out->second = *first;
+					++out;
+					start = first;
+				}
+				out[-1].first = N(last - start);
+				return out;
+			}
+
+			// counts the elements of [first1, last1) different from the element at the same position at first2.
+			template<typename T>
+			std::size_t count_mismatches_scalar(const T* first1, const T* last1, const T* first2) {
+				std::size_t r = 0;
+				for (; first1 != last1; ++first1, ++first2)
+					r += !(*first1 == *first2);
+				return r;
+			}
+
+			template<typename T>
+			const T* mismatch_scalar(const T* first1, const T* last1, const T* first2) {
+				while (first1 != last1 && *first1 == *first2) {
+					++first1;
+					++first2;
+				}
+				return first1;
+			}
+
+			// the bits set in x, without the popcnt instruction.
+			inline unsigned popcount_scalar(std::uint64_t x) {
+				x -= (x >> 1) & 0x5555555555555555ull;
+				x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+				x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0full;
+				return static_cast<unsigned>((x * 0x0101010101010101ull) >> 56);
+			}
+
+			inline std::uint64_t load_word(const std::uint8_t* p) {
+				std::uint64_t x;
+				std::memcpy(&x, p, sizeof(x));
+				return x;
+			}
+
+			inline std::size_t bit_distance_scalar(const std::uint8_t* a, const std::uint8_t* b, std::size_t n) {
+				std::size_t r = 0;
+				for (; n >= 8; a += 8, b += 8, n -= 8)
+					r += popcount_scalar(load_word(a) ^ load_word(b));
+				for (; n != 0; ++a, ++b, --n)
+					r += popcount_scalar(*a ^ *b);
+				return r;
+			}
+
+#ifdef XP_HAS_X86_SIMD
+			// The comparisons return a mask with all the bits of the equal lanes set,
+			// so that _mm_movemask_epi8 yields sizeof(T) bits per lane whatever the type.
+			template<typename T, std::size_t = sizeof(T), bool = std::is_floating_point<T>::value>
+			struct sse_lanes;
+
+			template<typename T>
+			struct sse_lanes<T, 1, false> {
+				XP_TARGET("sse4.1") static __m128i splat(T x) { return _mm_set1_epi8(static_cast<char>(x)); }
+				XP_TARGET("sse4.1") static __m128i equal(__m128i x, __m128i y) { return _mm_cmpeq_epi8(x, y); }
+			};
+			template<typename T>
+			struct sse_lanes<T, 2, false> {
+				XP_TARGET("sse4.1") static __m128i splat(T x) { return _mm_set1_epi16(static_cast<short>(x)); }
+				XP_TARGET("sse4.1") static __m128i equal(__m128i x, __m128i y) { return _mm_cmpeq_epi16(x, y); }
+			};
+			template<typename T>
+			struct sse_lanes<T, 4, false> {
+				XP_TARGET("sse4.1") static __m128i splat(T x) { return _mm_set1_epi32(static_cast<int>(x)); }
+				XP_TARGET("sse4.1") static __m128i equal(__m128i x, __m128i y) { return _mm_cmpeq_epi32(x, y); }
+			};
+			template<typename T>
+			struct sse_lanes<T, 8, false> {
+				XP_TARGET("sse4.1") static __m128i splat(T x) { return _mm_set1_epi64x(static_cast<long long>(x)); }
+				XP_TARGET("sse4.1") static __m128i equal(__m128i x, __m128i y) { return _mm_cmpeq_epi64(x, y); }
+			};
+			template<>
+			struct sse_lanes<float, 4, true> {
+				XP_TARGET("sse4.1") static __m128i splat(float x) { return _mm_castps_si128(_mm_set1_ps(x)); }
+				XP_TARGET("sse4.1") static __m128i equal(__m128i x, __m128i y) { return _mm_castps_si128(_mm_cmpeq_ps(_mm_castsi128_ps(x), _mm_castsi128_ps(y))); }
+			};
+			template<>
+			struct sse_lanes<double, 8, true> {
+				XP_TARGET("sse4.1") static __m128i splat(double x) { return _mm_castpd_si128(_mm_set1_pd(x)); }
+				XP_TARGET("sse4.1") static __m128i equal(__m128i x, __m128i y) { return _mm_castpd_si128(_mm_cmpeq_pd(_mm_castsi128_pd(x), _mm_castsi128_pd(y))); }
+			};
+
+			template<typename T, std::size_t = sizeof(T), bool = std::is_floating_point<T>::value>
+			struct avx2_lanes;
+
+			template<typename T>
+			struct avx2_lanes<T, 1, false> {
+				XP_TARGET("avx2") static __m256i splat(T x) { return _mm256_set1_epi8(static_cast<char>(x)); }
+				XP_TARGET("avx2") static __m256i equal(__m256i x, __m256i y) { return _mm256_cmpeq_epi8(x, y); }
+			};
+			template<typename T>
+			struct avx2_lanes<T, 2, false> {
+				XP_TARGET("avx2") static __m256i splat(T x) { return _mm256_set1_epi16(static_cast<short>(x)); }
+				XP_TARGET("avx2") static __m256i equal(__m256i x, __m256i y) { return _mm256_cmpeq_epi16(x, y); }
+			};
+			template<typename T>
+			struct avx2_lanes<T, 4, false> {
+				XP_TARGET("avx2") static __m256i splat(T x) { return _mm256_set1_epi32(static_cast<int>(x)); }
+				XP_TARGET("avx2") static __m256i equal(__m256i x, __m256i y) { return _mm256_cmpeq_epi32(x, y); }
+			};
+			template<typename T>
+			struct avx2_lanes<T, 8, false> {
+				XP_TARGET("avx2") static __m256i splat(T x) { return _mm256_set1_epi64x(static_cast<long long>(x)); }
+				XP_TARGET("avx2") static __m256i equal(__m256i x, __m256i y) { return _mm256_cmpeq_epi64(x, y); }
+			};
+			template<>
+			struct avx2_lanes<float, 4, true> {
+				XP_TARGET("avx2") static __m256i splat(float x) { return _mm256_castps_si256(_mm256_set1_ps(x)); }
+				XP_TARGET("avx2") static __m256i equal(__m256i x, __m256i y) { return _mm256_castps_si256(_mm256_cmp_ps(_mm256_castsi256_ps(x), _mm256_castsi256_ps(y), _CMP_EQ_OQ)); }
+			};
+			template<>
+			struct avx2_lanes<double, 8, true> {
+				XP_TARGET("avx2") static __m256i splat(double x) { return _mm256_castpd_si256(_mm256_set1_pd(x)); }
+				XP_TARGET("avx2") static __m256i equal(__m256i x, __m256i y) { return _mm256_castpd_si256(_mm256_cmp_pd(_mm256_castsi256_pd(x), _mm256_castsi256_pd(y), _CMP_EQ_OQ)); }
+			};
+
+			// the shuffle reversing the order of the elements of Bytes bytes in 16 bytes.
+			template<std::size_t Bytes>
+			XP_TARGET("sse4.1") inline __m128i reverse_mask() {
+				alignas(16) char m[16];
+				for (std::size_t i = 0; i != 16; ++i)
+					m[i] = static_cast<char>(16 - Bytes * (i / Bytes + 1) + i % Bytes);
+				return _mm_load_si128(reinterpret_cast<const __m128i*>(m));
+			}
+
+			// a vector from each end is loaded, reversed, and stored at the other end.
+			template<typename T>
+			XP_TARGET("sse4.1") void reverse_sse41(T* first, T* last) {
+				const std::ptrdiff_t k = 16 / sizeof(T);
+				auto mask = reverse_mask<sizeof(T)>();
+				while (last - first >= 2 * k) {
+					last -= k;
+					auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+					auto y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(last));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(first), _mm_shuffle_epi8(y, mask));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(last), _mm_shuffle_epi8(x, mask));
+					first += k;
+				}
+				reverse_scalar(first, last);
+			}
+
+			// the shuffle reverses the elements in each half of the vector, then the halves are swapped.
+			template<typename T>
+			XP_TARGET("avx2") void reverse_avx2(T* first, T* last) {
+				const std::ptrdiff_t k = 32 / sizeof(T);
+				auto mask = _mm256_broadcastsi128_si256(reverse_mask<sizeof(T)>());
+				while (last - first >= 2 * k) {
+					last -= k;
+					auto x = _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(first)), mask);
+					auto y = _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(last)), mask);
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(first), _mm256_permute2x128_si256(y, y, 1));
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(last), _mm256_permute2x128_si256(x, x, 1));
+					first += k;
+				}
+				reverse_sse41(first, last);
+			}
+
+			template<typename T>
+			XP_TARGET("sse4.1") const T* find_sse41(const T* first, const T* last, T val) {
+				const std::ptrdiff_t k = 16 / sizeof(T);
+				auto x = sse_lanes<T>::splat(val);
+				for (; last - first >= k; first += k) {
+					auto y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+					std::uint32_t mask = _mm_movemask_epi8(sse_lanes<T>::equal(x, y));
+					if (mask) return first + lowest_bit(mask) / sizeof(T);
+				}
+				return find_scalar(first, last, val);
+			}
+
+			template<typename T>
+			XP_TARGET("sse4.1") const T* find_backward_sse41(const T* first, const T* last, T val) {
+				const std::ptrdiff_t k = 16 / sizeof(T);
+				auto x = sse_lanes<T>::splat(val);
+				auto it = last;
+				for (; it - first >= k; ) {
+					it -= k;
+					auto y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+					std::uint32_t mask = _mm_movemask_epi8(sse_lanes<T>::equal(x, y));
+					if (mask) return it + highest_bit(mask) / sizeof(T);
+				}
+				auto found = find_backward_scalar(first, it, val);
+				return found == it ? last : found;
+			}
+
+			// two vectors per iteration, 64 bytes, a cache line.
+			template<typename T>
+			XP_TARGET("avx2") const T* find_avx2(const T* first, const T* last, T val) {
+				const std::ptrdiff_t k = 32 / sizeof(T);
+				auto x = avx2_lanes<T>::splat(val);
+				for (; last - first >= 2 * k; first += 2 * k) {
+					auto y0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+					auto y1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first + k));
+					auto e0 = avx2_lanes<T>::equal(x, y0);
+					auto e1 = avx2_lanes<T>::equal(x, y1);
+					if (_mm256_testz_si256(_mm256_or_si256(e0, e1), _mm256_or_si256(e0, e1))) continue;
+					std::uint32_t mask = _mm256_movemask_epi8(e0);
+					if (mask) return first + lowest_bit(mask) / sizeof(T);
+					mask = _mm256_movemask_epi8(e1);
+					return first + k + lowest_bit(mask) / sizeof(T);
+				}
+				for (; last - first >= k; first += k) {
+					auto y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+					std::uint32_t mask = _mm256_movemask_epi8(avx2_lanes<T>::equal(x, y));
+					if (mask) return first + lowest_bit(mask) / sizeof(T);
+				}
+				return find_scalar(first, last, val);
+			}
+
+			template<typename T>
+			XP_TARGET("avx2") const T* find_backward_avx2(const T* first, const T* last, T val) {
+				const std::ptrdiff_t k = 32 / sizeof(T);
+				auto x = avx2_lanes<T>::splat(val);
+				auto it = last;
+				for (; it - first >= 2 * k; ) {
+					it -= 2 * k;
+					auto y0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(it));
+					auto y1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(it + k));
+					auto e0 = avx2_lanes<T>::equal(x, y0);
+					auto e1 = avx2_lanes<T>::equal(x, y1);
+					if (_mm256_testz_si256(_mm256_or_si256(e0, e1), _mm256_or_si256(e0, e1))) continue;
+					std::uint32_t mask = _mm256_movemask_epi8(e1);
+					if (mask) return it + k + highest_bit(mask) / sizeof(T);
+					mask = _mm256_movemask_epi8(e0);
+					return it + highest_bit(mask) / sizeof(T);
+				}
+				for (; it - first >= k; ) {
+					it -= k;
+					auto y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(it));
+					std::uint32_t mask = _mm256_movemask_epi8(avx2_lanes<T>::equal(x, y));
+					if (mask) return it + highest_bit(mask) / sizeof(T);
+				}
+				auto found = find_backward_scalar(first, it, val);
+				return found == it ? last : found;
+			}
+
+			XP_TARGET("popcnt") inline unsigned popcount(std::uint32_t mask) {
+#if defined(_MSC_VER)
+				return __popcnt(mask);
+#else
+				return __builtin_popcount(mask);
+#endif
+			}
+
+			// one bit per lane in the masks of _mm256_movemask_epi8.
+			template<std::size_t Bytes>
+			struct lane_bits;
+			template<> struct lane_bits<1> { static const std::uint32_t value = 0xffffffff; };
+			template<> struct lane_bits<2> { static const std::uint32_t value = 0x55555555; };
+			template<> struct lane_bits<4> { static const std::uint32_t value = 0x11111111; };
+			template<> struct lane_bits<8> { static const std::uint32_t value = 0x01010101; };
+
+			template<typename T>
+			XP_TARGET("avx2") const T* find_not_avx2(const T* first, const T* last, T val) {
+				const std::ptrdiff_t k = 32 / sizeof(T);
+				auto x = avx2_lanes<T>::splat(val);
+				for (; last - first >= k; first += k) {
+					auto y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+					std::uint32_t mask = ~std::uint32_t(_mm256_movemask_epi8(avx2_lanes<T>::equal(x, y)));
+					if (mask) return first + lowest_bit(mask) / sizeof(T);
+				}
+				return find_not_scalar(first, last, val);
+			}
+
+			// The matches of a vector are taken from its mask, so that the short gaps between them cost no search.
+			template<typename T, typename F>
+			XP_TARGET("avx2") void for_each_equal_avx2(const T* first, const T* last, T val, F& f) {
+				const std::ptrdiff_t k = 32 / sizeof(T);
+				auto x = avx2_lanes<T>::splat(val);
+				for (; last - first >= k; first += k) {
+					auto y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+					std::uint32_t mask = std::uint32_t(_mm256_movemask_epi8(avx2_lanes<T>::equal(x, y))) & lane_bits<sizeof(T)>::value;
+					while (mask) {
+						f(first + lowest_bit(mask) / sizeof(T));
+						mask &= mask - 1;
+					}
+				}
+				for_each_equal_scalar(first, last, val, f);
+			}
+
+			// Each block of 8 elements of a is compared with all the rotations of a block of b, and conversely, so the matches
+			// of both blocks are found without branches. The matches of a block are accumulated until the block is passed,
+			// which happens when its last element is not greater than the last one of the other block.
+			template<typename T, typename O1, typename O2, typename O3>
+			XP_TARGET("avx2") void partition_sets_avx2(const T* a, const T* la, const T* b, const T* lb, O1& only1, O2& only2, O3& both) {
+				const auto rotate = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+				std::uint32_t ma = 0, mb = 0;
+				while (la - a >= 8 && lb - b >= 8) {
+					auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a));
+					auto y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b));
+					auto ex = _mm256_cmpeq_epi32(x, y);
+					auto ey = ex;
+					auto rx = x;
+					auto ry = y;
+					for (int r = 1; r != 8; ++r) {
+						rx = _mm256_permutevar8x32_epi32(rx, rotate);
+						ry = _mm256_permutevar8x32_epi32(ry, rotate);
+						ex = _mm256_or_si256(ex, _mm256_cmpeq_epi32(x, ry));
+						ey = _mm256_or_si256(ey, _mm256_cmpeq_epi32(y, rx));
+					}
+					ma |= _mm256_movemask_ps(_mm256_castsi256_ps(ex));
+					mb |= _mm256_movemask_ps(_mm256_castsi256_ps(ey));
+					T last_a = a[7];
+					T last_b = b[7];
+					if (!(last_b < last_a)) {
+						for (int l = 0; l != 8; ++l) {
+							if (ma >> l & 1) {
+								*both = a[l];
+								++both;
+							}
+							else {
+								*only1 = a[l];
+								++only1;
+							}
+						}
+						a += 8;
+						ma = 0;
+					}
+					if (!(last_a < last_b)) {
+						for (int l = 0; l != 8; ++l) {
+							if (mb >> l & 1) continue;
+							*only2 = b[l];
+							++only2;
+						}
+						b += 8;
+						mb = 0;
+					}
+				}
+				partition_sets_scalar(a, la, b, lb, ma, mb, only1, only2, both);
+			}
+
+			// Compares each vector with the same vector shifted by one element, the second load hitting the cache.
+			// No branch depends on the values.
+			template<typename T>
+			XP_TARGET("avx2,popcnt") std::size_t count_adjacent_differences_avx2(const T* first, const T* last) {
+				const std::ptrdiff_t k = 32 / sizeof(T);
+				std::size_t r = 0;
+				for (; last - first >= k; first += k) {
+					auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+					auto y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first - 1));
+					std::uint32_t mask = ~std::uint32_t(_mm256_movemask_epi8(avx2_lanes<T>::equal(x, y)));
+					r += popcount(mask & lane_bits<sizeof(T)>::value);
+				}
+				return r + count_adjacent_differences_scalar(first, last);
+			}
+
+			// The loop over the bits of a mask only runs for the boundaries of the runs, so the long runs
+			// cost a comparison per vector.
+			template<typename T, typename N>
+			XP_TARGET("avx2") std::pair<N, T>* run_length_encode_avx2(const T* start, const T* first, const T* last, std::pair<N, T>* out) {
+				const std::ptrdiff_t k = 32 / sizeof(T);
+				for (; last - first >= k; first += k) {
+					auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+					auto y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first - 1));
+					std::uint32_t mask = ~std::uint32_t(_mm256_movemask_epi8(avx2_lanes<T>::equal(x, y))) & lane_bits<sizeof(T)>::value;
+					while (mask) {
+						auto boundary = first + lowest_bit(mask) / sizeof(T);
+						out[-1].first = N(boundary - start);
+						out->second = *boundary;
+						++out;
+						start = boundary;
+						mask &= mask - 1;
+					}
+				}
+				return run_length_encode_scalar(start, first, last, out);
+			}
+
+			template<typename T>
+			XP_TARGET("avx2,popcnt") std::size_t count_mismatches_avx2(const T* first1, const T* last1, const T* first2) {
+				const std::ptrdiff_t k = 32 / sizeof(T);
+				std::size_t r = 0;
+				for (; last1 - first1 >= k; first1 += k, first2 += k) {
+					auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first1));
+					auto y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first2));
+					std::uint32_t mask = ~std::uint32_t(_mm256_movemask_epi8(avx2_lanes<T>::equal(x, y)));
+					r += popcount(mask & lane_bits<sizeof(T)>::value);
+				}
+				return r + count_mismatches_scalar(first1, last1, first2);
+			}
+
+			template<typename T>
+			XP_TARGET("avx2") const T* mismatch_avx2(const T* first1, const T* last1, const T* first2) {
+				const std::ptrdiff_t k = 32 / sizeof(T);
+				for (; last1 - first1 >= k; first1 += k, first2 += k) {
+					auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first1));
+					auto y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first2));
+					std::uint32_t mask = ~std::uint32_t(_mm256_movemask_epi8(avx2_lanes<T>::equal(x, y)));
+					if (mask) return first1 + lowest_bit(mask) / sizeof(T);
+				}
+				return mismatch_scalar(first1, last1, first2);
+			}
+
+			XP_TARGET("popcnt") inline unsigned popcount(std::uint64_t x) {
+#if defined(_MSC_VER) && defined(_M_X64)
+				return static_cast<unsigned>(__popcnt64(x));
+#elif defined(_MSC_VER)
+				return __popcnt(static_cast<std::uint32_t>(x)) + __popcnt(static_cast<std::uint32_t>(x >> 32));
+#else
+				return __builtin_popcountll(x);
+#endif
+			}
+
+			// The bits set in each 8 bytes of x. The bits of each nibble are looked up with a shuffle,
+			// then the bytes are summed with sad.
+			XP_TARGET("avx2") inline __m256i popcount_words(__m256i x) {
+				const auto table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+				const auto nibble = _mm256_set1_epi8(0x0f);
+				auto low = _mm256_shuffle_epi8(table, _mm256_and_si256(x, nibble));
+				auto high = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble));
+				return _mm256_sad_epu8(_mm256_add_epi8(low, high), _mm256_setzero_si256());
+			}
+
+			XP_TARGET("avx2,popcnt") inline std::size_t bit_distance_avx2(const std::uint8_t* a, const std::uint8_t* b, std::size_t n) {
+				auto sums = _mm256_setzero_si256();
+				for (; n >= 32; a += 32, b += 32, n -= 32) {
+					auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a));
+					auto y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b));
+					sums = _mm256_add_epi64(sums, popcount_words(_mm256_xor_si256(x, y)));
+				}
+				alignas(32) std::uint64_t s[4];
+				_mm256_store_si256(reinterpret_cast<__m256i*>(s), sums);
+				std::size_t r = static_cast<std::size_t>(s[0] + s[1] + s[2] + s[3]);
+				for (; n >= 8; a += 8, b += 8, n -= 8)
+					r += popcount(load_word(a) ^ load_word(b));
+				for (; n != 0; ++a, ++b, --n)
+					r += popcount(std::uint32_t(*a ^ *b));
+				return r;
+			}
+
+			// The codes of 8 or 16 bytes are compared 4 or 2 at a time with the query repeated in a vector,
+			// the sums of popcount_words being their distances. The longer codes are compared one at a time.
+			template<typename D>
+			XP_TARGET("avx2,popcnt") void bit_distances_avx2(const std::uint8_t* query, const std::uint8_t* codes, std::size_t n, std::size_t bytes, D* out) {
+				alignas(32) std::uint64_t s[4];
+				if (bytes == 8) {
+					auto q = _mm256_set1_epi64x(static_cast<long long>(load_word(query)));
+					for (; n >= 4; codes += 32, out += 4, n -= 4) {
+						auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(codes));
+						_mm256_store_si256(reinterpret_cast<__m256i*>(s), popcount_words(_mm256_xor_si256(q, x)));
+						out[0] = D(s[0]);
+						out[1] = D(s[1]);
+						out[2] = D(s[2]);
+						out[3] = D(s[3]);
+					}
+				}
+				else if (bytes == 16) {
+					auto q = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(query)));
+					for (; n >= 2; codes += 32, out += 2, n -= 2) {
+						auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(codes));
+						_mm256_store_si256(reinterpret_cast<__m256i*>(s), popcount_words(_mm256_xor_si256(q, x)));
+						out[0] = D(s[0] + s[1]);
+						out[1] = D(s[2] + s[3]);
+					}
+				}
+				for (; n != 0; codes += bytes, ++out, --n)
+					*out = D(bit_distance_avx2(query, codes, bytes));
+			}
+#endif
+
+		} // namespace details
+
+		// The smallest and the largest of a range of values.
+		template<typename T>
+		struct bounds {
+			T min;
+			T max;
+		};
+
+		// The types whose bounds are vectorized.
+		template<typename T>
+		struct has_bounds : std::integral_constant<bool,
+			std::is_same<T, float>::value || std::is_same<T, double>::value
+			|| (std::is_integral<T>::value && std::is_signed<T>::value && (sizeof(T) == 4 || sizeof(T) == 8))> {};
+
+		namespace details {
+
+#ifdef XP_HAS_X86_SIMD
+			template<typename T, std::size_t = sizeof(T), bool = std::is_floating_point<T>::value>
+			struct avx2_ordered;
+
+			template<>
+			struct avx2_ordered<double, 8, true> {
+				typedef __m256d V;
+				XP_TARGET("avx2") static V load(const double* p) { return _mm256_loadu_pd(p); }
+				XP_TARGET("avx2") static void store(double* p, V x) { _mm256_storeu_pd(p, x); }
+				XP_TARGET("avx2") static V min(V x, V y) { return _mm256_min_pd(x, y); }
+				XP_TARGET("avx2") static V max(V x, V y) { return _mm256_max_pd(x, y); }
+				XP_TARGET("avx2") static __m256i unordered(V x) { return _mm256_castpd_si256(_mm256_cmp_pd(x, x, _CMP_UNORD_Q)); }
+			};
+			template<>
+			struct avx2_ordered<float, 4, true> {
+				typedef __m256 V;
+				XP_TARGET("avx2") static V load(const float* p) { return _mm256_loadu_ps(p); }
+				XP_TARGET("avx2") static void store(float* p, V x) { _mm256_storeu_ps(p, x); }
+				XP_TARGET("avx2") static V min(V x, V y) { return _mm256_min_ps(x, y); }
+				XP_TARGET("avx2") static V max(V x, V y) { return _mm256_max_ps(x, y); }
+				XP_TARGET("avx2") static __m256i unordered(V x) { return _mm256_castps_si256(_mm256_cmp_ps(x, x, _CMP_UNORD_Q)); }
+			};
+			template<typename T>
+			struct avx2_ordered<T, 8, false> {
+				typedef __m256i V;
+				XP_TARGET("avx2") static V load(const T* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+				XP_TARGET("avx2") static void store(T* p, V x) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), x); }
+				XP_TARGET("avx2") static V min(V x, V y) { return _mm256_blendv_epi8(x, y, _mm256_cmpgt_epi64(x, y)); }
+				XP_TARGET("avx2") static V max(V x, V y) { return _mm256_blendv_epi8(x, y, _mm256_cmpgt_epi64(y, x)); }
+				XP_TARGET("avx2") static __m256i unordered(V) { return _mm256_setzero_si256(); }
+			};
+			template<typename T>
+			struct avx2_ordered<T, 4, false> {
+				typedef __m256i V;
+				XP_TARGET("avx2") static V load(const T* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+				XP_TARGET("avx2") static void store(T* p, V x) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), x); }
+				XP_TARGET("avx2") static V min(V x, V y) { return _mm256_min_epi32(x, y); }
+				XP_TARGET("avx2") static V max(V x, V y) { return _mm256_max_epi32(x, y); }
+				XP_TARGET("avx2") static __m256i unordered(V) { return _mm256_setzero_si256(); }
+			};
+
+			// Two independent pairs of accumulators, so that the latency of min and max is hidden.
+			template<typename T>
+			XP_TARGET("avx2") bool find_bounds_avx2(const T* first, std::size_t n, bounds<T>& r) {
+				typedef avx2_ordered<T> A;
+				const std::size_t k = 32 / sizeof(T);
+				if (n < 2 * k) return false;
+
+				auto low0 = A::load(first);
+				auto low1 = A::load(first + k);
+				auto high0 = low0;
+				auto high1 = low1;
+				auto unordered = _mm256_or_si256(A::unordered(low0), A::unordered(low1));
+				std::size_t j = 2 * k;
+				for (; j + 2 * k <= n; j += 2 * k) {
+					auto x0 = A::load(first + j);
+					auto x1 = A::load(first + j + k);
+					unordered = _mm256_or_si256(unordered, _mm256_or_si256(A::unordered(x0), A::unordered(x1)));
+					low0 = A::min(low0, x0);
+					low1 = A::min(low1, x1);
+					high0 = A::max(high0, x0);
+					high1 = A::max(high1, x1);
+				}
+				if (j + k <= n) {
+					auto x = A::load(first + j);
+					unordered = _mm256_or_si256(unordered, A::unordered(x));
+					low0 = A::min(low0, x);
+					high0 = A::max(high0, x);
+					j += k;
+				}
+				if (!_mm256_testz_si256(unordered, unordered)) return false;
+
+				T lows[k], highs[k];
+				A::store(lows, A::min(low0, low1));
+				A::store(highs, A::max(high0, high1));
+				r.min = lows[0];
+				r.max = highs[0];
+				for (std::size_t l = 1; l != k; ++l) {
+					if (lows[l] < r.min) r.min = lows[l];
+					if (r.max < highs[l]) r.max = highs[l];
+				}
+				for (; j != n; ++j) {
+					auto x = first[j];
+					if (x != x) return false;
+					if (x < r.min) r.min = x;
+					if (r.max < x) r.max = x;
+				}
+				return true;
+			}
+#endif
+
+		} // namespace details
+
+		// Computes the bounds of the n values at first. Returns false, without computing them,
+		// when there is no kernel for the instruction set, when n is smaller than two vectors,
+		// or when a value is not ordered (NaN), leaving it to the caller to compare the values one by one.
+		// The positions of the bounds can then be found with find and find_backward.
+		template<typename T>
+		bool find_bounds(const T* first, std::size_t n, bounds<T>& r, instruction_set::sets isa = instruction_set::best()) {
+			static_assert(has_bounds<T>::value, "find_bounds requires a float, a double or a signed integer of 32 or 64 bits.");
+#ifdef XP_HAS_X86_SIMD
+			if (instruction_set::clamp(isa) == instruction_set::avx2)
+				return details::find_bounds_avx2(first, n, r);
+#else
+			(void)first;
+			(void)n;
+			(void)r;
+			(void)isa;
+#endif
+			return false;
+		}
+
+		const std::size_t cache_line = 64;
+
+		// Copies the cache line at src to dst, both aligned on a cache line, with non-temporal stores:
+		// the line is written to memory without being read first, and without evicting the cached ones.
+		// The stores are weakly ordered, store_fence must be called before another thread reads them.
+		XP_TARGET("sse2") inline void stream_line(void* dst, const void* src) {
+#if defined(XP_HAS_X86_SIMD)
+			auto d = static_cast<__m128i*>(dst);
+			auto s = static_cast<const __m128i*>(src);
+			_mm_stream_si128(d, _mm_load_si128(s));
+			_mm_stream_si128(d + 1, _mm_load_si128(s + 1));
+			_mm_stream_si128(d + 2, _mm_load_si128(s + 2));
+			_mm_stream_si128(d + 3, _mm_load_si128(s + 3));
+#else
+			std::memcpy(dst, src, cache_line);
+#endif
+		}
+
+		XP_TARGET("sse2") inline void store_fence() {
+#if defined(XP_HAS_X86_SIMD)
+			_mm_sfence();
+#endif
+		}
+
+		// Hints the cpu to load the cache line of p. Never faults, even on an invalid address.
+		inline void prefetch(const void* p) {
+#if defined(XP_HAS_X86_SIMD)
+			_mm_prefetch(static_cast<const char*>(p), _MM_HINT_T0);
+#elif defined(__GNUC__)
+			__builtin_prefetch(p);
+#else
+			(void)p;
+#endif
+		}
+
+		// Returns the first element equal to val, or last.
+		template<typename T>
+		const T* find(const T* first, const T* last, T val, instruction_set::sets isa = instruction_set::best()) {
+			static_assert(is_vectorizable<T>::value, "find requires an integral or floating point type.");
+#ifdef XP_HAS_X86_SIMD
+			switch (instruction_set::clamp(isa)) {
+			case instruction_set::avx2: return details::find_avx2(first, last, val);
+			case instruction_set::sse41: return details::find_sse41(first, last, val);
+			default: break;
+			}
+#else
+			(void)isa;
+#endif
+			return details::find_scalar(first, last, val);
+		}
+
+		// Returns the last element equal to val, or last.
+		template<typename T>
+		const T* find_backward(const T* first, const T* last, T val, instruction_set::sets isa = instruction_set::best()) {
+			static_assert(is_vectorizable<T>::value, "find_backward requires an integral or floating point type.");
+#ifdef XP_HAS_X86_SIMD
+			switch (instruction_set::clamp(isa)) {
+			case instruction_set::avx2: return details::find_backward_avx2(first, last, val);
+			case instruction_set::sse41: return details::find_backward_sse41(first, last, val);
+			default: break;
+			}
+#else
+			(void)isa;
+#endif
+			return details::find_backward_scalar(first, last, val);
+		}
+
+		// Returns the first element different from val, or last.
+		template<typename T>
+		const T* find_not(const T* first, const T* last, T val, instruction_set::sets isa = instruction_set::best()) {
+			static_assert(is_vectorizable<T>::value, "find_not requires an integral or floating point type.");
+#ifdef XP_HAS_X86_SIMD
+			if (instruction_set::clamp(isa) == instruction_set::avx2)
+				return details::find_not_avx2(first, last, val);
+#else
+			(void)isa;
+#endif
+			return details::find_not_scalar(first, last, val);
+		}
+
+		// Calls f with each element equal to val, in order, like a memchr returning all the matches of a buffer.
+		template<typename T, typename F>
+		F for_each_equal(const T* first, const T* last, T val, F f, instruction_set::sets isa = instruction_set::best()) {
+			static_assert(is_vectorizable<T>::value, "for_each_equal requires an integral or floating point type.");
+#ifdef XP_HAS_X86_SIMD
+			if (instruction_set::clamp(isa) == instruction_set::avx2) {
+				details::for_each_equal_avx2(first, last, val, f);
+				return f;
+			}
+#else
+			(void)isa;
+#endif
+			details::for_each_equal_scalar(first, last, val, f);
+			return f;
+		}
+
+		// The types of the sets partitioned by blocks.
+		template<typename T>
+		struct has_set_blocks : std::integral_constant<bool, std::is_integral<T>::value && sizeof(T) == 4> {};
+
+		// Writes the elements only in [first1, last1) to only1, the ones only in [first2, last2) to only2,
+		// and the ones in both to both. The ranges must be sorted, without duplicates.
+		template<typename T, typename O1, typename O2, typename O3>
+		std::tuple<O1, O2, O3> partition_sets(const T* first1, const T* last1, const T* first2, const T* last2, O1 only1, O2 only2, O3 both, instruction_set::sets isa = instruction_set::best()) {
+			static_assert(has_set_blocks<T>::value, "partition_sets requires an integer of 32 bits.");
+#ifdef XP_HAS_X86_SIMD
+			if (instruction_set::clamp(isa) == instruction_set::avx2) {
+				details::partition_sets_avx2(first1, last1, first2, last2, only1, only2, both);
+				return std::make_tuple(only1, only2, both);
+			}
+#else
+			(void)isa;
+#endif
+			details::partition_sets_scalar(first1, last1, first2, last2, 0, 0, only1, only2, both);
+			return std::make_tuple(only1, only2, both);
+		}
+
+		// The types reversed by shuffling their bytes.
+		template<typename T>
+		struct is_byte_reversible : std::integral_constant<bool,
+			std::is_trivially_copyable<T>::value && (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8)> {};
+
+		template<typename T>
+		void reverse(T* first, T* last, instruction_set::sets isa = instruction_set::best()) {
+			static_assert(is_byte_reversible<T>::value, "reverse requires a trivially copyable type of 1, 2, 4 or 8 bytes.");
+#ifdef XP_HAS_X86_SIMD
+			switch (instruction_set::clamp(isa)) {
+			case instruction_set::avx2: return details::reverse_avx2(first, last);
+			case instruction_set::sse41: return details::reverse_sse41(first, last);
+			default: break;
+			}
+#else
+			(void)isa;
+#endif
+			details::reverse_scalar(first, last);
+		}
+
+		// Returns the count of the runs of equal elements, that is 1 + the count of the elements different from their predecessor.
+		// NaN is different from itself, so each NaN is a run.
+		template<typename T>
+		std::size_t count_runs(const T* first, const T* last, instruction_set::sets isa = instruction_set::best()) {
+			static_assert(is_vectorizable<T>::value, "count_runs requires an integral or floating point type.");
+			if (first == last) return 0;
+#ifdef XP_HAS_X86_SIMD
+			if (instruction_set::clamp(isa) == instruction_set::avx2)
+				return 1 + details::count_adjacent_differences_avx2(first + 1, last);
+#else
+			(void)isa;
+#endif
+			return 1 + details::count_adjacent_differences_scalar(first + 1, last);
+		}
+
+		// Writes a pair (count, value) per run of equal elements to out, and returns the end of the pairs written.
+		// out must have room for count_runs(first, last) pairs.
+		template<typename T, typename N>
+		std::pair<N, T>* run_length_encode(const T* first, const T* last, std::pair<N, T>* out, instruction_set::sets isa = instruction_set::best()) {
+			static_assert(is_vectorizable<T>::value, "run_length_encode requires an integral or floating point type.");
+			if (first == last) return out;
+			out->second = *first;
+#ifdef XP_HAS_X86_SIMD
+			if (instruction_set::clamp(isa) == instruction_set::avx2)
+				return details::run_length_encode_avx2(first, first + 1, last, out + 1);
+#else
+			(void)isa;
+#endif
+			return details::run_length_encode_scalar(first, first + 1, last, out + 1);
+		}
+
+		// Returns the count of the elements of [first1, last1) different from the element at the same position at first2.
+		template<typename T>
+		std::size_t count_mismatches(const T* first1, const T* last1, const T* first2, instruction_set::sets isa = instruction_set::best()) {
+			static_assert(is_vectorizable<T>::value, "count_mismatches requires an integral or floating point type.");
+#ifdef XP_HAS_X86_SIMD
+			if (instruction_set::clamp(isa) == instruction_set::avx2)
+				return details::count_mismatches_avx2(first1, last1, first2);
+#else
+			(void)isa;
+#endif
+			return details::count_mismatches_scalar(first1, last1, first2);
+		}
+
+		// Returns the first element of [first1, last1) different from the element at the same position at first2, or last1.
+		template<typename T>
+		const T* mismatch(const T* first1, const T* last1, const T* first2, instruction_set::sets isa = instruction_set::best()) {
+			static_assert(is_vectorizable<T>::value, "mismatch requires an integral or floating point type.");
+#ifdef XP_HAS_X86_SIMD
+			if (instruction_set::clamp(isa) == instruction_set::avx2)
+				return details::mismatch_avx2(first1, last1, first2);
+#else
+			(void)isa;
+#endif
+			return details::mismatch_scalar(first1, last1, first2);
+		}
+
+		// Returns the count of the bits different in the n bytes at first1 and first2, their Hamming distance as bit strings.
+		inline std::size_t bit_distance(const std::uint8_t* first1, const std::uint8_t* first2, std::size_t n, instruction_set::sets isa = instruction_set::best()) {
+#ifdef XP_HAS_X86_SIMD
+			if (instruction_set::clamp(isa) == instruction_set::avx2)
+				return details::bit_distance_avx2(first1, first2, n);
+#else
+			(void)isa;
+#endif
+			return details::bit_distance_scalar(first1, first2, n);
+		}
+
+		// Writes to out the bit distance from the query to each of the n codes at codes, laid out contiguously,
+		// all of the size of the query, and returns the end of the distances written.
+		template<typename D>
+		D* bit_distances(const std::uint8_t* query, const std::uint8_t* codes, std::size_t n, std::size_t bytes, D* out, instruction_set::sets isa = instruction_set::best()) {
+#ifdef XP_HAS_X86_SIMD
+			if (instruction_set::clamp(isa) == instruction_set::avx2) {
+				details::bit_distances_avx2(query, codes, n, bytes, out);
+				return out + n;
+			}
+#else
+			(void)isa;
+#endif
+			for (; n != 0; codes += bytes, ++out, --n)
+				*out = D(details::bit_distance_scalar(query, codes, bytes));
+			return out;
+		}
+
+	} // namespace simd
+} // namespace xp
+
+#endif __SIMD_H__
@@ -0,0 +1,101 @@
+#include <cstdio>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "temporary_file.h"
+
+namespace {
+	// the offsets of the views must be multiples of it.
+	std::uint64_t granularity() {
+#if defined(_WIN32)
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return info.dwAllocationGranularity;
+#else
+		return static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE));
+#endif
+	}
+}
+
+xp::temporary_file::view::~view() {
+	if (!base) return;
+#if defined(_WIN32)
+	UnmapViewOfFile(base);
+#else
+	munmap(base, mapped);
+#endif
+}
+
+xp::temporary_file::temporary_file() : length(0) {
+#if defined(_WIN32)
+	wchar_t dir[MAX_PATH + 1];
+	wchar_t path[MAX_PATH + 1];
+	if (!GetTempPathW(MAX_PATH + 1, dir) || !GetTempFileNameW(dir, L"xp", 0, path))
+		throw std::runtime_error("cannot name a temporary file");
+	file = CreateFileW(path, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+		FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		throw std::runtime_error("cannot create a temporary file");
+#else
+	file = std::tmpfile();
+	if (!file)
+		throw std::runtime_error("cannot create a temporary file");
+#endif
+}
+
+xp::temporary_file::~temporary_file() {
+#if defined(_WIN32)
+	CloseHandle(file);
+#else
+	std::fclose(static_cast<std::FILE*>(file));
+#endif
+}
+
+void xp::temporary_file::append(const void* p, std::size_t n) {
+#if defined(_WIN32)
+	auto bytes = static_cast<const char*>(p);
+	while (n != 0) {
+		DWORD chunk = n < (1u << 30) ? static_cast<DWORD>(n) : (1u << 30);
+		DWORD written = 0;
+		if (!WriteFile(file, bytes, chunk, &written, nullptr) || written == 0)
+			throw std::runtime_error("cannot write to a temporary file");
+		bytes += written;
+		n -= written;
+		length += written;
+	}
+#else
+	if (std::fwrite(p, 1, n, static_cast<std::FILE*>(file)) != n)
+		throw std::runtime_error("cannot write to a temporary file");
+	length += n;
+#endif
+}
+
+xp::temporary_file::view xp::temporary_file::map(std::uint64_t offset, std::size_t n) {
+	auto start = offset - offset % granularity();
+	auto mapped = static_cast<std::size_t>(offset - start) + n;
+#if defined(_WIN32)
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping)
+		throw std::runtime_error("cannot map a temporary file");
+	void* base = MapViewOfFile(mapping, FILE_MAP_READ, static_cast<DWORD>(start >> 32), static_cast<DWORD>(start), mapped);
+	CloseHandle(mapping); // the view keeps the mapping open
+	if (!base)
+		throw std::runtime_error("cannot map a temporary file");
+#else
+	auto f = static_cast<std::FILE*>(file);
+	if (std::fflush(f) != 0)
+		throw std::runtime_error("cannot write to a temporary file");
+	void* base = mmap(nullptr, mapped, PROT_READ, MAP_SHARED, fileno(f), static_cast<off_t>(start));
+	if (base == MAP_FAILED)
+		throw std::runtime_error("cannot map a temporary file");
+#endif
+	return view(base, mapped, static_cast<std::size_t>(offset - start));
+}
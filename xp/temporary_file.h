@@ -0,0 +1,72 @@
+#ifndef __TEMPORARY_FILE_H__
+#define __TEMPORARY_FILE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+// A temporary file, deleted when closed, to spill data that does not fit in memory.
+// The data is appended, then read back through views mapping parts of the file in memory,
+// so that reading it takes no buffer and the pages are dropped by the os when memory is short.
+//
+// The system calls are in temporary_file.cpp, which must be linked in the program, so that
+// including this file does not bring the headers of the os.
+
+namespace xp {
+
+	class temporary_file {
+		void* file; // a HANDLE on Windows, a FILE* elsewhere
+		std::uint64_t length;
+
+	public:
+		// A part of the file mapped in memory, read only, unmapped when destroyed.
+		class view {
+			void* base;
+			std::size_t mapped;
+			std::size_t offset; // of the data in the mapping
+
+			friend class temporary_file;
+
+			view(void* base, std::size_t mapped, std::size_t offset) : base(base), mapped(mapped), offset(offset) {}
+
+		public:
+			view(view&& x) : base(x.base), mapped(x.mapped), offset(x.offset) {
+				x.base = nullptr;
+			}
+			view& operator=(view&& x) {
+				std::swap(base, x.base);
+				std::swap(mapped, x.mapped);
+				std::swap(offset, x.offset);
+				return *this;
+			}
+			~view();
+
+			view(const view&) = delete;
+			view& operator=(const view&) = delete;
+
+			const void* data() const {
+				return static_cast<const char*>(base) + offset;
+			}
+		};
+
+		// Throws std::runtime_error when the file cannot be created.
+		temporary_file();
+		~temporary_file();
+
+		temporary_file(const temporary_file&) = delete;
+		temporary_file& operator=(const temporary_file&) = delete;
+
+		std::uint64_t size() const {
+			return length;
+		}
+
+		// Writes the n bytes at p at the end of the file. Throws std::runtime_error when the disk is full.
+		void append(const void* p, std::size_t n);
+
+		// Maps the n bytes at offset, which must have been appended.
+		view map(std::uint64_t offset, std::size_t n);
+	};
+
+} // namespace xp
+
+#endif __TEMPORARY_FILE_H__
@@ -1,17 +1,23 @@
+#include <cctype>
+#include <chrono>
 #include <cstddef>
 #include <exception>
+#include <forward_list>
 #include <functional>
 #include <initializer_list>
 #include <iomanip>
 #include <iostream>
 #include <iterator>
+#include <list>
 #include <memory>
+#include <numeric>
 #include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "../algorithm.h"
+#include "../report.h"
 
 #include "testbench.h"
 
@@ -276,4 +282,229 @@ TEST(check_reverse_forward_iterator) {
 	VERIFY(std::is_sorted(v.begin(), v.end()));
 }
 
+TEST(check_reverse_n) {
+	for (int n : {0, 1, 2, 3, 10, 1000}) {
+		forward_list<int> l(n);
+		iota(l.begin(), l.end(), 0);
+		auto last = reverse_n(l.begin(), n);
+		VERIFY(last == l.end());
+		VERIFY(std::is_sorted(l.begin(), l.end(), greater<int>()));
+
+		reverse_n_forward(l.begin(), n);
+		VERIFY(std::is_sorted(l.begin(), l.end()));
+	}
+
+	vector<string> v {"a", "b", "c", "d"};
+	VERIFY(reverse_n(v.begin(), 3) == v.begin() + 3);
+	VERIFY((v == vector<string>{"c", "b", "a", "d"}));
+
+	vector<double> d(100);
+	iota(d.begin(), d.end(), 0.);
+	VERIFY(reverse_n(d.data(), d.size()) == d.data() + d.size());
+	VERIFY(std::is_sorted(d.begin(), d.end(), greater<double>()));
+}
+
+// larger than the buffer, so that the halves are reversed through it.
+TEST(check_reverse_n_larger_than_the_buffer) {
+	const int n = int(details::reverse_buffer_bytes / sizeof(int)) * 3 + 1;
+	forward_list<int> l(n);
+	iota(l.begin(), l.end(), 0);
+	reverse_n(l.begin(), n);
+	VERIFY(std::is_sorted(l.begin(), l.end(), greater<int>()));
+}
+
+TEST(bench_reverse_forward_list) {
+	forward_list<int> l(1 << 16);
+	iota(l.begin(), l.end(), 0);
+	auto n = distance(l.begin(), l.end());
+
+	benchmark_options options;
+	options.sample_count = 10;
+	auto recursive = run_benchmark<chrono::steady_clock>([&]() { return reverse_n_forward(l.begin(), n); }, options);
+	auto buffered = run_benchmark<chrono::steady_clock>([&]() { return reverse_n(l.begin(), n); }, options);
+	cout << "    " << recursive.median.count() << " ns recursive, " << buffered.median.count() << " ns buffered" << endl;
+	REPORT("recursive", recursive);
+	REPORT("buffered", buffered);
+}
+
+TEST(check_slide) {
+	for (int n = 0; n != 12; ++n) {
+		for (int f = 0; f <= n; ++f) {
+			for (int l = f; l <= n; ++l) {
+				for (int p = 0; p <= n; ++p) {
+					vector<int> v(n);
+					iota(v.begin(), v.end(), 0);
+					auto w = v;
+					auto expected = p < f ? make_pair(p, p + l - f) : l < p ? make_pair(p - (l - f), p) : make_pair(f, l);
+					auto r = slide(v.data() + f, v.data() + l, v.data() + p);
+					VERIFY(r.first == v.data() + expected.first && r.second == v.data() + expected.second);
+					auto q = slide(w.begin() + f, w.begin() + l, w.begin() + p);
+					VERIFY(q.first == w.begin() + expected.first && q.second == w.begin() + expected.second);
+					VERIFY(v == w);
+					VERIFY(std::is_sorted(v.begin(), v.begin() + expected.first) && std::is_sorted(v.begin() + expected.second, v.end()));
+				}
+			}
+		}
+	}
+}
+
+TEST(check_rotate_with_a_small_buffer) {
+	int buffer[3];
+	for (int n = 0; n != 40; ++n) {
+		for (int m = 0; m <= n; ++m) {
+			vector<int> v(n);
+			iota(v.begin(), v.end(), 0);
+			auto expected = v;
+			std::rotate(expected.begin(), expected.begin() + m, expected.end());
+			VERIFY(details::rotate_with_buffer(v.data(), v.data() + m, v.data() + n, buffer, 3) == v.data() + (n - m));
+			VERIFY(v == expected);
+		}
+	}
+}
+
+TEST(check_gather) {
+	auto selected = [](int x) { return x % 3 == 0; };
+	for (int n = 0; n != 20; ++n) {
+		for (int p = 0; p <= n; ++p) {
+			vector<int> v(n);
+			iota(v.begin(), v.end(), 1);
+			auto expected = v;
+			auto lower = stable_partition(expected.begin(), expected.begin() + p, [&](int x) { return !selected(x); });
+			auto upper = stable_partition(expected.begin() + p, expected.end(), selected);
+			size_t moved = 0;
+			for (int i = 0; i != n; ++i) moved += v[i] != expected[i];
+
+			auto r = gather(v.data(), v.data() + n, v.data() + p, selected);
+			VERIFY(v == expected);
+			VERIFY(r.first - v.data() == lower - expected.begin() && r.second - v.data() == upper - expected.begin());
+			VERIFY_EQ(moved, r.moved);
+
+			list<int> l(n);
+			iota(l.begin(), l.end(), 1);
+			auto g = gather(l.begin(), l.end(), next(l.begin(), p), selected);
+			VERIFY(equal(l.begin(), l.end(), expected.begin()));
+			VERIFY_EQ(moved, g.moved);
+		}
+	}
+
+	vector<string> s {"a", "B", "c", "D", "e", "F", "g"};
+	pair<vector<string>::iterator, vector<string>::iterator> r;
+	r = gather(s.begin(), s.end(), s.begin() + 3, [](const string& x) { return isupper(x[0]) != 0; });
+	VERIFY((s == vector<string>{"a", "c", "B", "D", "F", "e", "g"}));
+	VERIFY(r.first == s.begin() + 2 && r.second == s.begin() + 5);
+}
+
+TEST(bench_slide_and_gather) {
+	// a few items of a list of millions, slid across it or gathered.
+	vector<int> v(1 << 22);
+	iota(v.begin(), v.end(), 0);
+	auto selected = [](int x) { return x % 1000 == 0; };
+	const ptrdiff_t n = v.size();
+
+	benchmark_options options;
+	options.sample_count = 10;
+	auto rotated = run_benchmark<chrono::steady_clock>([&]() { return std::rotate(v.begin() + 100, v.begin() + 1100, v.end() - 100); }, options);
+	auto slid = run_benchmark<chrono::steady_clock>([&]() { return slide(v.data() + 100, v.data() + 1100, v.data() + n - 100); }, options);
+	// the selection is scattered again before each gather.
+	vector<int> w;
+	auto partitioned = run_benchmark<chrono::steady_clock>([&]() {
+		w = v;
+		return make_pair(stable_partition(w.begin(), w.begin() + n / 2, [&](int x) { return !selected(x); }), stable_partition(w.begin() + n / 2, w.end(), selected));
+	}, options);
+	auto gathered = run_benchmark<chrono::steady_clock>([&]() {
+		w = v;
+		return gather(w.data(), w.data() + n, w.data() + n / 2, selected).moved;
+	}, options);
+	cout << "    " << rotated.median.count() << " ns rotated, " << slid.median.count() << " ns slid, "
+		<< partitioned.median.count() << " ns partitioned, " << gathered.median.count() << " ns gathered" << endl;
+	REPORT("rotate", rotated);
+	REPORT("slide", slid);
+	REPORT("stable_partition", partitioned);
+	REPORT("gather", gathered);
+}
+
+TEST(check_transform_while_with_a_counted_guard) {
+	for (int n = 0; n != 11; ++n) {
+		vector<int> v(n);
+		iota(v.begin(), v.end(), 1);
+		vector<int> expected(n);
+		std::transform(v.begin(), v.end(), expected.begin(), [](int x) { return x * 3; });
+
+		// the order of the calls is kept, so a stateful op sees the elements in order.
+		vector<int> r(n + 1, -1);
+		int calls = 0;
+		auto op = [&calls](int x) { return ++calls == x ? x * 3 : 0; };
+		VERIFY(transform_while(v.data(), make_bounded_guard(v.data() + n), r.data(), op) == r.data() + n);
+		VERIFY(equal(expected.begin(), expected.end(), r.begin()) && r[n] == -1);
+
+		vector<int> l;
+		transform_while(v.begin(), make_bounded_guard(v.end()), back_inserter(l), [](int x) { return x * 3; });
+		VERIFY(l == expected);
+
+		vector<int> w(n + 2, 1);
+		auto add = [](int x, int y) { return x + y; };
+		VERIFY(transform_while(v.data(), make_bounded_guard(v.data() + n), w.data(), make_bounded_guard(w.data() + n + 2), r.data(), add) == r.data() + n);
+		VERIFY(transform_while(w.data(), make_bounded_guard(w.data() + n + 2), v.data(), make_bounded_guard(v.data() + n), r.data(), add) == r.data() + n);
+		VERIFY(transform_while(v.data(), w.data(), make_bounded_guard(v.data() + n), r.data(), add) == r.data() + n);
+		VERIFY(equal(v.begin(), v.end(), r.begin(), [](int x, int y) { return x + 1 == y; }));
+	}
+}
+
+TEST(check_transform_backward_in_blocks) {
+	for (int n = 0; n != 11; ++n) {
+		// the result overlaps the input, shifted by 2.
+		vector<int> v(n + 2);
+		iota(v.begin(), v.end(), 1);
+		vector<int> expected = v;
+		for (int i = n - 1; i >= 0; --i) expected[i + 2] = -expected[i];
+		list<int> l(v.begin(), v.end());
+
+		transform_backward(v.begin(), v.begin() + n, v.begin() + n + 2, negate<int>());
+		VERIFY(v == expected);
+		transform_backward(l.begin(), next(l.begin(), n), l.end(), negate<int>());
+		VERIFY(equal(l.begin(), l.end(), v.begin()));
+
+		vector<int> r(n);
+		transform_backward(v.begin() + 1, v.begin() + n + 1, v.begin() + n, r.end(), minus<int>());
+		for (int i = 0; i != n; ++i)
+			VERIFY_EQ(v[i + 1] - v[i], r[i]);
+	}
+}
+
+TEST(bench_transform_while) {
+	// in the cache, so that the loops are measured rather than the memory.
+	vector<float> v(1 << 14, 1.f);
+	vector<float> r(v.size());
+	const float* first = v.data();
+	const float* last = first + v.size();
+	auto op = [](float x) { return x * 2.f + 1.f; };
+
+	benchmark_options options;
+	options.sample_count = 10;
+	auto guarded = run_benchmark<chrono::steady_clock>([&]() { return transform_while(first, [last](const float* p) { return p != last; }, r.data(), op); }, options);
+	auto counted = run_benchmark<chrono::steady_clock>([&]() { return transform_while(first, make_bounded_guard(last), r.data(), op); }, options);
+	auto backward = run_benchmark<chrono::steady_clock>([&]() { return transform_backward(first, last, r.data() + r.size(), op); }, options);
+	cout << "    " << guarded.median.count() << " ns guarded, " << counted.median.count() << " ns counted, " << backward.median.count() << " ns backward" << endl;
+	REPORT("guarded", guarded);
+	REPORT("counted", counted);
+	REPORT("backward", backward);
+}
+
+TEST(check_foldr) {
+	auto foldr_of = [](const string& s) {
+		istringstream in(s);
+		return foldr(istream_iterator<int>(in), istream_iterator<int>(), minus<int>(), 0);
+	};
+	VERIFY_EQ(0, foldr_of(""));
+	VERIFY_EQ(7, foldr_of("7"));
+	VERIFY_EQ(3, foldr_of("1 2 3 4 5")); // 1 - (2 - (3 - (4 - 5)))
+
+	list<int> l {1, 2, 3, 4, 5};
+	VERIFY_EQ(3, foldr(l.begin(), l.end(), minus<int>(), 0));
+
+	istringstream in("a b c");
+	auto words = foldr(istream_iterator<string>(in), istream_iterator<string>(), [](const string& x, const string& y) { return y + x; }, string());
+	VERIFY_EQ(string("cba"), words);
+}
+
 TESTFIXTURE(algorithm)
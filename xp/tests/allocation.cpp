@@ -0,0 +1,119 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../allocation.h"
+#include "../bag.h"
+#include "../heap.h"
+
+#include "testbench.h"
+
+using namespace std;
+using namespace xp;
+
+TESTBENCH()
+
+// the global operator new is tracked only when allocation_tracking.cpp is linked in.
+TEST(check_operator_new_is_tracked) {
+	SKIP(!operator_new_is_tracked(), "operator new is not replaced.");
+	allocation_tracker t;
+	{
+		auto p = make_unique<int[]>(100);
+		auto q = make_unique<double>(1.);
+		do_not_optimize(p); // so that the allocations are not elided
+		do_not_optimize(q);
+	}
+	auto counts = t.elapsed();
+
+	VERIFY_EQ(2u, counts.allocations);
+	VERIFY_EQ(2u, counts.deallocations);
+	VERIFY(counts.bytes >= 100 * sizeof(int) + sizeof(double));
+	VERIFY_EQ(counts.bytes, counts.peak);
+}
+
+#ifdef __cpp_aligned_new
+TEST(check_aligned_operator_new_is_tracked) {
+	SKIP(!operator_new_is_tracked(), "operator new is not replaced.");
+	struct alignas(64) line {
+		char bytes[64];
+	};
+	allocation_tracker t;
+	{
+		auto p = make_unique<line>();
+		auto q = make_unique<line[]>(3);
+		VERIFY_EQ(0u, reinterpret_cast<uintptr_t>(p.get()) % 64);
+		VERIFY_EQ(0u, reinterpret_cast<uintptr_t>(q.get()) % 64);
+		do_not_optimize(p);
+		do_not_optimize(q);
+	}
+	auto counts = t.elapsed();
+
+	VERIFY_EQ(2u, counts.allocations);
+	VERIFY_EQ(2u, counts.deallocations);
+	VERIFY(counts.bytes >= 4 * sizeof(line));
+}
+#endif
+
+TEST(can_count_reallocations) {
+	allocation_stats stats;
+	allocation_tracker t(stats);
+	{
+		vector<int, counting_allocator<int>> v {counting_allocator<int>(stats)};
+		for (int i = 0; i != 1000; ++i)
+			v.push_back(i);
+	}
+	auto counts = t.elapsed();
+
+	VERIFY(counts.allocations > 1);
+	VERIFY_EQ(counts.allocations, counts.deallocations);
+	VERIFY_EQ(counts.allocations - 1, counts.reallocations);
+	VERIFY(counts.peak >= 1000 * sizeof(int));
+	VERIFY_EQ(0u, stats.live_bytes());
+}
+
+TEST(can_count_bag_allocations) {
+	allocation_stats stats;
+	allocation_tracker t(stats);
+	{
+		bag<int, counting_allocator<int>> b {counting_allocator<int>(stats)};
+		for (int i = 0; i != 100; ++i)
+			b.push_back(i);
+	}
+	auto counts = t.elapsed();
+
+	VERIFY(counts.allocations > 1);
+	VERIFY_EQ(counts.allocations, counts.deallocations);
+	VERIFY(counts.reallocations > 0);
+}
+
+TEST(can_count_heap_allocations) {
+	typedef vector<int, counting_allocator<int>> container;
+
+	allocation_stats stats;
+	allocation_tracker t(stats);
+	{
+		heap<int, less<int>, container> h {counting_allocator<int>(stats)};
+		for (int i = 0; i != 100; ++i)
+			h.push(i);
+		VERIFY_EQ(99, h.top());
+	}
+	auto counts = t.elapsed();
+
+	VERIFY(counts.allocations > 1);
+	VERIFY_EQ(counts.allocations, counts.deallocations);
+}
+
+TEST(can_measure_allocations) {
+	using namespace std::chrono;
+	SKIP(!operator_new_is_tracked(), "operator new is not replaced.");
+
+	auto m = measure_allocations<steady_clock>(100, []() { return string(100, 'x'); });
+
+	VERIFY_EQ(100u, m.second.allocations);
+	cout << "  " << duration_cast<nanoseconds>(m.first).count() << " ns, " << m.second << endl;
+}
+
+TESTFIXTURE(allocation)
@@ -1,5 +1,6 @@
 #include <chrono>
 #include <iostream>
+#include <random>
 #include <vector>
 
 #include "../numeric.h"
@@ -9,6 +10,22 @@
 
 using namespace xp;
 
+namespace {
+	// a clock too coarse to see a batch run.
+	struct frozen_clock {
+		typedef std::chrono::nanoseconds duration;
+		typedef duration::rep rep;
+		typedef duration::period period;
+		typedef std::chrono::time_point<frozen_clock> time_point;
+
+		static const bool is_steady = true;
+
+		static time_point now() {
+			return time_point();
+		}
+	};
+}
+
 TESTBENCH()
 
 TEST(can_reset) {
@@ -80,6 +97,78 @@ TEST(can_measure_durations) {
 	VERIFY(m.max() == s3);
 }
 
+TEST(can_compute_order_statistics) {
+	using namespace std;
+	using namespace std::chrono;
+
+	samples<microseconds> s;
+	for (int i : {7, 1, 9, 3, 5})
+		s += microseconds(i);
+
+	VERIFY(s.min() == microseconds(1));
+	VERIFY(s.max() == microseconds(9));
+	VERIFY(s.avg() == microseconds(5));
+	VERIFY(s.median() == microseconds(5));
+	VERIFY(s.percentile(.25) == microseconds(3));
+	VERIFY(s.percentile(1.) == microseconds(9));
+	VERIFY(s.mad() == microseconds(2));
+}
+
+TEST(can_discard_outliers) {
+	using namespace std;
+	using namespace std::chrono;
+
+	samples<microseconds> s;
+	for (int i : {10, 11, 12, 10, 11, 12, 10, 11, 12, 500})
+		s += microseconds(i);
+
+	auto stats = summarize(s);
+	VERIFY_EQ(9u, stats.n);
+	VERIFY_EQ(1u, stats.outliers);
+	VERIFY(stats.max == microseconds(12));
+	VERIFY(stats.median == microseconds(11));
+	VERIFY(stats.ci_lower <= stats.mean && stats.mean <= stats.ci_upper);
+}
+
+TEST(can_run_benchmark) {
+	using namespace std;
+	using namespace std::chrono;
+
+	benchmark_options options;
+	options.sample_count = 10;
+	options.target = milliseconds(1);
+
+	vector<int> v(1000);
+	auto stats = run_benchmark<steady_clock>([&]() { random_iota(v.begin(), v.end(), 0, mt19937 {1664}); }, options);
+
+	VERIFY(stats.n + stats.outliers == 10u);
+	VERIFY(stats.min <= stats.median && stats.median <= stats.p90 && stats.p90 <= stats.p99 && stats.p99 <= stats.max);
+	cout << "  median:" << stats.median.count() << "ns, p99:" << stats.p99.count() << "ns" << endl;
+}
+
+TEST(check_calibrate_ends_with_a_coarse_clock) {
+	using namespace std::chrono;
+
+	// the clock never advances, so the target is never reached.
+	VERIFY_EQ(1L << 16, calibrate<frozen_clock>([]() {}, milliseconds(1), 1L << 16));
+	VERIFY_EQ(1000L, calibrate<frozen_clock>([]() {}, milliseconds(1), 1000L));
+	VERIFY_EQ(1L, calibrate<frozen_clock>([]() {}, milliseconds(0), 1000L));
+}
+
+TEST(check_body_is_not_optimized_away) {
+	using namespace std;
+	using namespace std::chrono;
+
+	int x = 0;
+	measure<steady_clock>(1000, [&]() { return ++x; });
+	VERIFY_EQ(1000, x);
+
+	auto overhead = loop_overhead<steady_clock>();
+	VERIFY(overhead > nanoseconds::zero());
+	VERIFY(is_suspiciously_fast(overhead, overhead));
+	VERIFY(!is_suspiciously_fast(overhead * 3, overhead));
+}
+
 TEST(check_processor_clock) {
 	using namespace std;
 	using namespace std::chrono;
@@ -93,7 +182,7 @@ TEST(can_measure) {
 	using namespace std::chrono;
 
 	double x = 3.14159 / 2.;
-	auto m = measure<processor_clock>([=]() { sin(x); });
+	auto m = measure<processor_clock>([=]() { return sin(x); });
 
 	cout << "Speed " << (double)m.second / duration_cast<microseconds>(m.first).count() << " executions per microseconds." << endl;
 }
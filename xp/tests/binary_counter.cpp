@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../algorithm.h"
+#include "../report.h"
+
+#include "testbench.h"
+
+using namespace std;
+using namespace xp;
+
+namespace {
+	struct merge_sorted {
+		vector<int> operator()(const vector<int>& x, const vector<int>& y) const {
+			vector<int> r(x.size() + y.size());
+			merge(x.begin(), x.end(), y.begin(), y.end(), r.begin());
+			return r;
+		}
+	};
+
+	vector<string> letters(size_t n) {
+		vector<string> v(n);
+		for (size_t i = 0; i != n; ++i)
+			v[i] = string(1, char('a' + i % 26));
+		return v;
+	}
+}
+
+TESTBENCH()
+
+TEST(check_fixed_binary_counter_is_binary_counter) {
+	vector<double> v(10000);
+	mt19937 g {1664};
+	for (auto& x : v) x = uniform_real_distribution<double>(0., 1.)(g);
+
+	binary_counter<double, plus<double>> growing(plus<double>(), 0.);
+	fixed_binary_counter<double, plus<double>> one_by_one(plus<double>(), 0.);
+	fixed_binary_counter<double, plus<double>> by_blocks(plus<double>(), 0.);
+	for (auto x : v) {
+		growing.add(x);
+		one_by_one.add(x);
+	}
+	by_blocks.add_range(v.begin(), v.begin() + 3);
+	by_blocks.add_range(v.begin() + 3, v.end());
+
+	// same tree of operations, so the same rounding
+	VERIFY_EQ(growing.reduce(), one_by_one.reduce());
+	VERIFY_EQ(growing.reduce(), by_blocks.reduce());
+}
+
+TEST(check_add_range_keeps_the_order) {
+	auto v = letters(5000);
+	auto expected = accumulate(v.begin(), v.end(), string());
+
+	fixed_binary_counter<string, plus<string>> counter {plus<string>(), string()};
+	counter.add_range(v.begin(), v.end());
+	VERIFY(expected == counter.reduce());
+
+	list<string> l(v.begin(), v.end());
+	fixed_binary_counter<string, plus<string>> from_list {plus<string>(), string()};
+	from_list.add_range(l.begin(), l.end());
+	VERIFY(expected == from_list.reduce());
+}
+
+TEST(check_fixed_binary_counter_overflow) {
+	fixed_binary_counter<int, plus<int>, 2> counter(plus<int>(), 0);
+	counter.add(1);
+	counter.add(1);
+	counter.add(1);
+	try {
+		counter.add(1);
+	}
+	catch (const overflow_error&) {
+		return;
+	}
+	VERIFY(false);
+}
+
+TEST(check_reduce_balanced) {
+	auto v = letters(100000);
+	auto expected = accumulate(v.begin(), v.end(), string());
+	VERIFY(expected == reduce_balanced(execution::seq, v.begin(), v.end(), plus<string>(), string()));
+	VERIFY(expected == reduce_balanced(execution::par, v.begin(), v.end(), plus<string>(), string()));
+}
+
+TEST(can_merge_sort) {
+	vector<vector<int>> runs(100000);
+	mt19937 g {1664};
+	for (auto& r : runs) r.push_back(uniform_int_distribution<int>(0, 1000)(g));
+
+	auto sorted = reduce_balanced(execution::par, runs.begin(), runs.end(), merge_sorted(), vector<int>());
+	VERIFY_EQ(runs.size(), sorted.size());
+	VERIFY(std::is_sorted(sorted.begin(), sorted.end()));
+}
+
+TEST(check_pairwise_summation_is_accurate) {
+	vector<float> v(1 << 22, .1f);
+	float naive = accumulate(v.begin(), v.end(), 0.f);
+	float pairwise = reduce_balanced(execution::seq, v.begin(), v.end(), plus<float>(), 0.f);
+	double exact = .1f * double(v.size());
+	VERIFY(abs(pairwise - exact) < abs(naive - exact));
+	VERIFY(abs(pairwise - exact) / exact < 1e-6);
+}
+
+TEST(bench_pairwise_summation) {
+	vector<double> v(1 << 22, .1);
+	benchmark_options options;
+	options.sample_count = 10;
+
+	auto add = run_benchmark<chrono::steady_clock>([&]() {
+		fixed_binary_counter<double, plus<double>> counter(plus<double>(), 0.);
+		for (auto x : v) counter.add(x);
+		return counter.reduce();
+	}, options);
+	auto add_range = run_benchmark<chrono::steady_clock>([&]() { return reduce_balanced(execution::seq, v.begin(), v.end(), plus<double>(), 0.); }, options);
+	auto par = run_benchmark<chrono::steady_clock>([&]() { return reduce_balanced(execution::par, v.begin(), v.end(), plus<double>(), 0.); }, options);
+	cout << "    add: " << add.median.count() << " ns, add_range: " << add_range.median.count() << " ns, par: " << par.median.count() << " ns" << endl;
+	REPORT("add", add);
+	REPORT("add_range", add_range);
+	REPORT("par", par);
+}
+
+TESTFIXTURE(binary_counter)
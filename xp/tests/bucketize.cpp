@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <list>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../algorithm.h"
+#include "../report.h"
+
+#include "testbench.h"
+
+using namespace std;
+using namespace xp;
+
+namespace {
+	vector<uint32_t> random_keys(size_t n) {
+		mt19937 g(42);
+		vector<uint32_t> v(n);
+		for (auto& x : v) x = g();
+		return v;
+	}
+
+	// the expected grouping: stable, by bucket.
+	template<typename T, typename Key>
+	vector<T> sorted_by_bucket(vector<T> v, Key key) {
+		stable_sort(v.begin(), v.end(), [&](const T& x, const T& y) { return key(x) < key(y); });
+		return v;
+	}
+
+	struct low_byte {
+		size_t operator()(uint32_t x) const { return x & 0xff; }
+	};
+}
+
+TESTBENCH()
+
+TEST(check_bucketize_is_stable) {
+	auto v = random_keys(10000);
+	auto key = [](uint32_t x) { return (x >> 8) % 100; };
+	vector<uint32_t> out(v.size());
+	auto offsets = bucketize(v.data(), v.data() + v.size(), out.data(), 100, key);
+	VERIFY(out == sorted_by_bucket(v, key));
+	VERIFY_EQ(101u, offsets.size());
+	VERIFY_EQ(0u, offsets.front());
+	VERIFY_EQ(v.size(), offsets.back());
+	for (size_t b = 0; b != 100; ++b) {
+		VERIFY(all_of(out.begin() + offsets[b], out.begin() + offsets[b + 1], [&](uint32_t x) { return key(x) == b; }));
+	}
+}
+
+TEST(check_bucketize_at_any_position_in_a_line) {
+	auto v = random_keys(1000);
+	auto key = [](uint32_t x) { return x % 100; };
+	auto expected = sorted_by_bucket(v, key);
+	vector<uint32_t> out(v.size() + 16);
+	for (size_t shift = 0; shift != 16; ++shift) {
+		bucketize(v.begin(), v.end(), out.data() + shift, 100, key);
+		VERIFY(equal(expected.begin(), expected.end(), out.begin() + shift));
+	}
+}
+
+// up to 64 buckets, the elements are written directly, then through the write combining buffers.
+TEST(check_bucketize_around_the_write_combining_threshold) {
+	auto v = random_keys(5000);
+	vector<uint32_t> out(v.size());
+	for (uint32_t buckets : {63, 64, 65}) {
+		auto key = [buckets](uint32_t x) { return x % buckets; };
+		bucketize(v.data(), v.data() + v.size(), out.data(), buckets, key);
+		VERIFY(out == sorted_by_bucket(v, key));
+	}
+}
+
+TEST(check_bucketize_without_write_combining) {
+	vector<string> v {"pear", "fig", "apple", "kiwi", "plum", "date", "melon"};
+	vector<string> out(v.size());
+	auto key = [](const string& s) { return s.size() - 3; };
+	list<string> l(v.begin(), v.end());
+	auto offsets = bucketize(l.begin(), l.end(), out.begin(), 3, key);
+	VERIFY((out == vector<string>{"fig", "pear", "kiwi", "plum", "date", "apple", "melon"}));
+	VERIFY((offsets == vector<size_t>{0, 1, 5, 7}));
+}
+
+TEST(check_bucketize_n) {
+	vector<int> v {3, 1, 2, 0, 1, 3, 9, 9};
+	vector<int> out(6);
+	auto r = bucketize_n(v.data(), 6, out.data(), 4, [](int x) { return x; });
+	VERIFY(r.first == v.data() + 6);
+	VERIFY((out == vector<int>{0, 1, 1, 2, 3, 3}));
+	VERIFY((r.second == vector<size_t>{0, 1, 3, 4, 6}));
+}
+
+TEST(check_parallel_bucketize) {
+	auto v = random_keys(1 << 18);
+	vector<uint32_t> expected(v.size()), actual(v.size());
+	auto offsets = bucketize(v.data(), v.data() + v.size(), expected.data(), 256, low_byte());
+	VERIFY(offsets == bucketize(execution::par, v.data(), v.data() + v.size(), actual.data(), 256, low_byte()));
+	VERIFY(expected == actual);
+	VERIFY(offsets == bucketize(execution::par, v.begin(), v.end(), actual.begin(), 256, low_byte()));
+	VERIFY(expected == actual);
+}
+
+TEST(bench_bucketize) {
+	auto v = random_keys(1 << 22);
+	vector<uint32_t> out(v.size());
+
+	benchmark_options options;
+	options.sample_count = 10;
+	for (int bits : {4, 8, 12}) {
+		auto key = [bits](uint32_t x) { return x >> (32 - bits); };
+		size_t buckets = size_t(1) << bits;
+		auto direct = run_benchmark<chrono::steady_clock>([&]() { return bucketize(v.begin(), v.end(), out.begin(), buckets, key); }, options);
+		auto combined = run_benchmark<chrono::steady_clock>([&]() { return bucketize(v.data(), v.data() + v.size(), out.data(), buckets, key); }, options);
+		auto parallel = run_benchmark<chrono::steady_clock>([&]() { return bucketize(execution::par, v.data(), v.data() + v.size(), out.data(), buckets, key); }, options);
+		cout << "    " << buckets << " buckets: " << direct.median.count() << " ns direct, " << combined.median.count() << " ns write combined, "
+			<< parallel.median.count() << " ns in parallel" << endl;
+		REPORT("direct/" + to_string(buckets), direct);
+		REPORT("write_combined/" + to_string(buckets), combined);
+		REPORT("parallel/" + to_string(buckets), parallel);
+	}
+}
+
+TESTFIXTURE(bucketize)
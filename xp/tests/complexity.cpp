@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "../algorithm.h"
+#include "../complexity.h"
+#include "../report.h"
+
+#include "testbench.h"
+
+using namespace std;
+using namespace xp;
+
+namespace {
+	template<typename F>
+	complexity_fit fit(F f) {
+		vector<pair<size_t, double>> points;
+		for (auto n : geometric_sizes(16, 1 << 16))
+			points.emplace_back(n, f(double(n)));
+		return fit_complexity(points.begin(), points.end());
+	}
+}
+
+TESTBENCH()
+
+TEST(can_make_geometric_sizes) {
+	auto sizes = geometric_sizes(1, 100, 10.);
+	VERIFY_EQ(3u, sizes.size());
+	VERIFY_EQ(1u, sizes[0]);
+	VERIFY_EQ(100u, sizes[2]);
+}
+
+TEST(can_fit_complexity) {
+	VERIFY_EQ(complexity::o_1, fit([](double) { return 42.; }).order);
+	VERIFY_EQ(complexity::o_n, fit([](double n) { return 3. * n + 5.; }).order);
+	VERIFY_EQ(complexity::o_n_log_n, fit([](double n) { return n * log2(n); }).order);
+	VERIFY_EQ(complexity::o_n2, fit([](double n) { return .5 * n * n + n; }).order);
+
+	auto linear = fit([](double n) { return 3. * n; });
+	VERIFY(abs(linear.coefficient - 3.) < 1e-9);
+}
+
+TEST(can_fill_shapes) {
+	vector<int> v(100);
+
+	fill_shape(v.begin(), v.end(), input_shape::sorted, mt19937 {1664});
+	VERIFY(std::is_sorted(v.begin(), v.end()));
+
+	fill_shape(v.begin(), v.end(), input_shape::reversed, mt19937 {1664});
+	VERIFY(std::is_sorted(v.rbegin(), v.rend()));
+	VERIFY_EQ(0, v.back());
+
+	fill_shape(v.begin(), v.end(), input_shape::random, mt19937 {1664});
+	VERIFY(!std::is_sorted(v.begin(), v.end()));
+
+	fill_shape(v.begin(), v.end(), input_shape::few_unique, mt19937 {1664});
+	sort(v.begin(), v.end());
+	VERIFY_EQ(16, unique(v.begin(), v.end()) - v.begin());
+}
+
+TEST(bench_sort_family) {
+	benchmark_options options;
+	options.sample_count = 10;
+	options.target = chrono::milliseconds(1);
+
+	auto results = run_family<chrono::steady_clock, int>("sort", geometric_sizes(1 << 8, 1 << 18, 4.),
+		{input_shape::sorted, input_shape::random, input_shape::few_unique},
+		[](const vector<int>& x) {
+			auto v = x;
+			sort(v.begin(), v.end());
+		},
+		options);
+
+	for (auto& r : results) {
+		print_family(cout, r);
+		for (auto& p : r.points)
+			REPORT(string(input_shape::name(r.shape)) + "/" + to_string(p.n), p.stats);
+	}
+}
+
+TEST(check_operation_counts_of_cost_elements) {
+	auto sizes = geometric_sizes(1, 1 << 12, 4.);
+	auto shapes = {input_shape::sorted, input_shape::reversed, input_shape::random, input_shape::few_unique};
+	auto identity = [](const instrumented<int>& x) { return x; };
+
+	auto minmax = count_operations<int>("minmax_cost_element", sizes, shapes, [&](vector<instrumented<int>>& v) {
+		minmax_cost_element(v.begin(), v.end(), identity);
+	});
+	auto stable_max = count_operations<int>("stable_max_element", sizes, shapes, [](vector<instrumented<int>>& v) {
+		stable_max_element(v.begin(), v.end());
+	});
+	auto min = count_operations<int>("min_cost_element", sizes, shapes, [&](vector<instrumented<int>>& v) {
+		min_cost_element(v.begin(), v.end(), identity);
+	});
+
+	for (auto& t : minmax) {
+		print_operations(cout, t, instrumented_base::compare);
+		VERIFY(!t.find_violation(instrumented_base::compare, [](double n) { return 1.5 * n; }));
+		VERIFY_EQ(complexity::o_n, t.fit(instrumented_base::compare).order);
+	}
+	for (auto& t : stable_max)
+		VERIFY(!t.find_violation(instrumented_base::compare, [](double n) { return n - 1.; }));
+	for (auto& t : min)
+		VERIFY(!t.find_violation(instrumented_base::compare, [](double n) { return n - 1.; }));
+}
+
+TEST(check_minmax_cost_element_is_stable) {
+	vector<pair<int, int>> v {{2, 0}, {1, 1}, {3, 2}, {1, 3}, {3, 4}, {3, 5}, {1, 6}};
+	auto cost = [](const pair<int, int>& x) { return x.first; };
+	for (size_t n = 1; n <= v.size(); ++n) {
+		auto expected = minmax_element(v.begin(), v.begin() + n, [&](const pair<int, int>& x, const pair<int, int>& y) { return cost(x) < cost(y); });
+		auto result = minmax_cost_element(v.begin(), v.begin() + n, cost);
+		VERIFY(expected.first == result.first);
+		VERIFY(expected.second == result.second);
+	}
+}
+
+TESTFIXTURE(complexity)
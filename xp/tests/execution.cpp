@@ -0,0 +1,99 @@
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../algorithm.h"
+#include "../execution.h"
+#include "../report.h"
+
+#include "testbench.h"
+
+using namespace std;
+using namespace xp;
+
+namespace {
+	// associative but not commutative.
+	vector<string> letters(size_t n) {
+		vector<string> v(n);
+		for (size_t i = 0; i != n; ++i)
+			v[i] = string(1, char('a' + i % 26));
+		return v;
+	}
+
+	template<typename P>
+	bool check_reductions(P policy) {
+		for (size_t n : {0u, 1u, 7u, 8u, 9u, 100u, 100000u}) {
+			auto v = letters(n);
+			auto expected = accumulate(v.begin(), v.end(), string());
+			if (reduce(policy, v.begin(), v.end(), plus<string>(), string()) != expected) return false;
+			if (foldl(policy, v.begin(), v.end(), plus<string>(), string()) != expected) return false;
+			auto with_blanks = v;
+			for (size_t i = 0; i < n; i += 3)
+				with_blanks[i].clear();
+			auto nonzeroes = accumulate(with_blanks.begin(), with_blanks.end(), string());
+			if (reduce_nonzeroes(policy, with_blanks.begin(), with_blanks.end(), plus<string>(), string()) != nonzeroes) return false;
+		}
+		return true;
+	}
+}
+
+TESTBENCH()
+
+TEST(check_thread_pool_calls_each_index_once) {
+	vector<atomic<int>> calls(1000);
+	thread_pool::global().for_each_index(calls.size(), [&](size_t i) { ++calls[i]; });
+	for (auto& c : calls)
+		VERIFY_EQ(1, c.load());
+}
+
+TEST(check_thread_pool_rethrows) {
+	try {
+		thread_pool::global().for_each_index(100, [](size_t i) { if (i == 42) throw runtime_error("42"); });
+	}
+	catch (const runtime_error&) {
+		return;
+	}
+	VERIFY(false);
+}
+
+TEST(check_reductions_keep_the_order) {
+	VERIFY(check_reductions(execution::seq));
+	VERIFY(check_reductions(execution::unseq));
+	VERIFY(check_reductions(execution::par));
+	VERIFY(check_reductions(execution::par_unseq));
+}
+
+TEST(check_reductions_of_forward_ranges) {
+	list<int> l(100000, 1);
+	VERIFY_EQ(100000, reduce(execution::par, l.begin(), l.end(), plus<int>(), 0));
+	VERIFY_EQ(100000, reduce_nonempty(execution::par_unseq, l.begin(), l.end(), plus<int>()));
+}
+
+TEST(check_reduce_with_function) {
+	vector<int> v(100000);
+	iota(v.begin(), v.end(), 0);
+	auto twice = [](vector<int>::const_iterator i) { return 2LL * *i; };
+	VERIFY_EQ(99999LL * 100000LL, reduce(execution::par_unseq, v.cbegin(), v.cend(), plus<long long>(), twice, 0LL));
+}
+
+TEST(bench_reduce) {
+	vector<double> v(1 << 24, 1.);
+	benchmark_options options;
+	options.sample_count = 10;
+
+	auto seq = run_benchmark<chrono::steady_clock>([&]() { return reduce(execution::seq, v.begin(), v.end(), plus<double>(), 0.); }, options);
+	auto unseq = run_benchmark<chrono::steady_clock>([&]() { return reduce(execution::unseq, v.begin(), v.end(), plus<double>(), 0.); }, options);
+	auto par = run_benchmark<chrono::steady_clock>([&]() { return reduce(execution::par_unseq, v.begin(), v.end(), plus<double>(), 0.); }, options);
+	cout << "    seq: " << seq.median.count() << " ns, unseq: " << unseq.median.count() << " ns, par_unseq: " << par.median.count() << " ns" << endl;
+	REPORT("seq", seq);
+	REPORT("unseq", unseq);
+	REPORT("par_unseq", par);
+}
+
+TESTFIXTURE(execution)
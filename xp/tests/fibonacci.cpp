@@ -7,6 +7,7 @@
 #include <vector>
 
 #include "../benchmark.h"
+#include "../report.h"
 
 #include "testbench.h"
 
@@ -128,15 +129,16 @@ TEST(benchmark) {
 	typedef int value_type;
 
 	const value_type Val = 50000;
-	const int Repeat = 25000000;
-
-	auto ew = measure<C>(Repeat, bind(ewilliams::find, Val));
-	cout << "  ewilliams: " << (double)Repeat / duration_cast<microseconds>(ew).count() << " executions per microseconds." << endl;
-	auto sl = measure<C>(Repeat, bind(slewis::fibinv, Val));
-	cout << "  slewis:    " << (double)Repeat / duration_cast<microseconds>(sl).count() << " executions per microseconds." << endl;
-	auto vj = measure<C>(Repeat, bind(vjacquet::nearest_fibonnaci<value_type>, Val));
-	cout << "  vjacquet:  " << (double)Repeat / duration_cast<microseconds>(vj).count() << " executions per microseconds." << endl;
 
+	auto ew = run_benchmark<C>(bind(ewilliams::find, Val));
+	cout << "  ewilliams: median " << ew.median.count() << " ns, p99 " << ew.p99.count() << " ns." << endl;
+	REPORT("ewilliams", ew);
+	auto sl = run_benchmark<C>(bind(slewis::fibinv, Val));
+	cout << "  slewis:    median " << sl.median.count() << " ns, p99 " << sl.p99.count() << " ns." << endl;
+	REPORT("slewis", sl);
+	auto vj = run_benchmark<C>(bind(vjacquet::nearest_fibonnaci<value_type>, Val));
+	cout << "  vjacquet:  median " << vj.median.count() << " ns, p99 " << vj.p99.count() << " ns." << endl;
+	REPORT("vjacquet", vj);
 }
 
 TESTFIXTURE(fibonacci)
@@ -7,12 +7,15 @@
 #include <functional>
 #include <iostream>
 #include <iterator>
+#include <limits>
+#include <list>
 #include <random>
 #include <utility>
 #include <vector>
 
 #include "../algorithm.h"
 #include "../benchmark.h"
+#include "../report.h"
 #include "testbench.h"
 
 using namespace std;
@@ -146,6 +149,11 @@ namespace {
 		return *min_cost_element(first, last, cost());
 	}
 
+	Foo const& get_lowest_scalar(const Foo* first, const Foo* last) {
+		assert(first != last);
+		return *details::compare_cost_element_nonempty(first, last, cost(), less<>());
+	}
+
 	Foo const& get_lowest_mem_fn(const Foo* first, const Foo* last) {
 		assert(first != last);
 		return *min_cost_element(first, last, mem_fn(&Foo::bar));
@@ -244,6 +252,84 @@ TEST(check_get_lowest_stackoverflow) {
 	cout << "  lowest: " << lowest.id << endl;
 }
 
+TEST(check_vectorized_cost_elements_are_stable) {
+	vector<double> v(1000);
+	mt19937 g(1664);
+	for (auto& x : v) x = double(uniform_int_distribution<int>(0, 20)(g));
+	list<double> l(v.begin(), v.end());
+	auto identity = [](double x) { return x; };
+
+	// the list is not random access, its costs are compared one by one.
+	for (size_t n = 1; n <= v.size(); n += 37) {
+		auto first = v.begin();
+		auto last = first + n;
+		auto lfirst = l.begin();
+		auto llast = next(lfirst, n);
+		VERIFY(distance(first, min_cost_element(first, last, identity)) == distance(lfirst, min_cost_element(lfirst, llast, identity)));
+		VERIFY(distance(first, max_cost_element(first, last, identity)) == distance(lfirst, max_cost_element(lfirst, llast, identity)));
+		VERIFY(distance(first, stable_max_cost_element(first, last, identity)) == distance(lfirst, stable_max_cost_element(lfirst, llast, identity)));
+		auto r = minmax_cost_element(first, last, identity);
+		auto expected = minmax_element(first, last);
+		VERIFY(r.first == expected.first);
+		VERIFY(r.second == expected.second);
+	}
+}
+
+TEST(check_vectorized_cost_elements_with_nan) {
+	vector<double> v(100, 1.);
+	v[10] = 0.;
+	v[20] = numeric_limits<double>::quiet_NaN();
+	v[30] = 2.;
+	auto identity = [](double x) { return x; };
+	VERIFY(min_cost_element(v.begin(), v.end(), identity) == v.begin() + 10);
+	VERIFY(max_cost_element(v.begin(), v.end(), identity) == v.begin() + 30);
+}
+
+// a first NaN is never replaced as the minimum, nor as the first maximum, whether the costs are vectorized or not.
+TEST(check_vectorized_cost_elements_with_a_first_nan) {
+	vector<double> v(1000);
+	for (size_t i = 0; i != v.size(); ++i) v[i] = double(i % 7);
+	v[0] = numeric_limits<double>::quiet_NaN();
+	list<double> l(v.begin(), v.end());
+	auto identity = [](double x) { return x; };
+
+	auto position = [&v](vector<double>::iterator i) { return distance(v.begin(), i); };
+	auto lposition = [&l](list<double>::iterator i) { return distance(l.begin(), i); };
+	VERIFY_EQ(lposition(min_cost_element(l.begin(), l.end(), identity)), position(min_cost_element(v.begin(), v.end(), identity)));
+	VERIFY_EQ(lposition(max_cost_element(l.begin(), l.end(), identity)), position(max_cost_element(v.begin(), v.end(), identity)));
+	VERIFY_EQ(lposition(stable_max_cost_element(l.begin(), l.end(), identity)), position(stable_max_cost_element(v.begin(), v.end(), identity)));
+	auto r = minmax_cost_element(v.begin(), v.end(), identity);
+	auto lr = minmax_cost_element(l.begin(), l.end(), identity);
+	VERIFY_EQ(lposition(lr.first), position(r.first));
+	VERIFY_EQ(lposition(lr.second), position(r.second));
+}
+
+// the leading NaNs are skipped in a loop, however many there are.
+TEST(check_vectorized_cost_elements_with_leading_nans) {
+	const double nan = numeric_limits<double>::quiet_NaN();
+	auto identity = [](double x) { return x; };
+	for (size_t leading : {1, 2, 300, 5000, 100000}) {
+		vector<double> v(leading, nan);
+		v.push_back(1.);
+		v.push_back(3.);
+		v.push_back(2.);
+		v.push_back(3.);
+		list<double> l(v.begin(), v.end());
+		auto position = [&v](vector<double>::iterator i) { return distance(v.begin(), i); };
+		auto lposition = [&l](list<double>::iterator i) { return distance(l.begin(), i); };
+
+		VERIFY_EQ(0, position(min_cost_element(v.begin(), v.end(), identity)));
+		VERIFY_EQ(0, position(max_cost_element(v.begin(), v.end(), identity)));
+		VERIFY_EQ(ptrdiff_t(leading + 3), position(stable_max_cost_element(v.begin(), v.end(), identity)));
+		VERIFY_EQ(lposition(stable_max_cost_element(l.begin(), l.end(), identity)), position(stable_max_cost_element(v.begin(), v.end(), identity)));
+	}
+
+	// only NaNs: the last maximum is the last one.
+	vector<double> v(1000, nan);
+	VERIFY(stable_max_cost_element(v.begin(), v.end(), identity) == v.end() - 1);
+	VERIFY(max_cost_element(v.begin(), v.end(), identity) == v.begin());
+}
+
 TEST(bench_get_lowest) {
 	const int attempts = 20000;
 
@@ -253,13 +339,14 @@ TEST(bench_get_lowest) {
 		make_pair("get_lowest_wierd", &get_lowest_wierd),
 		make_pair("get_lowest_wrapped_wierd", &get_lowest_wrapped_wierd),
 		make_pair("get_lowest", &get_lowest),
+		make_pair("get_lowest_scalar", &get_lowest_scalar),
 		make_pair("get_lowest_mem_fn", &get_lowest_mem_fn),
 		make_pair("get_lowest_lambda", &get_lowest_lambda),
 		make_pair("get_lowest_stackoverflow", &get_lowest_stackoverflow),
 	};
 
 	for (auto& scenario : scenarii) {
-		measures<microseconds> m;
+		samples<microseconds> m;
 		for (int attempt = 0; attempt != attempts; ++attempt) {
 			auto& v = Sample;
 			for_each(v.begin(), v.end(), mem_fn(&Foo::reset));
@@ -271,8 +358,23 @@ TEST(bench_get_lowest) {
 			auto result = scenario.second(first, last);
 			m += w.elapsed<microseconds>();
 		}
-		cout << "  " << scenario.first << " took an average of " << m.avg().count() << " us." << endl;
+		cout << "  " << scenario.first << " took an average of " << m.avg().count() << " us (p50 " << m.median().count() << " us, p99 " << m.percentile(.99).count() << " us)." << endl;
+		REPORT(scenario.first, summarize(m));
 	}
 }
 
+TEST(bench_get_minmax) {
+	auto& v = Sample;
+	auto first = v.data();
+	auto last = first + v.size();
+	benchmark_options options;
+	options.sample_count = 20;
+
+	auto vectorized = run_benchmark<steady_clock>([&]() { return minmax_cost_element(first, last, cost()); }, options);
+	auto pairwise = run_benchmark<steady_clock>([&]() { return details::minmax_cost_element_nonempty(first, last, cost(), false_type()); }, options);
+	cout << "  minmax_cost_element took " << vectorized.median.count() << " ns, by pairs " << pairwise.median.count() << " ns." << endl;
+	REPORT("minmax_cost_element", vectorized);
+	REPORT("minmax_cost_element_by_pairs", pairwise);
+}
+
 TESTFIXTURE(get_lowest)
\ No newline at end of file
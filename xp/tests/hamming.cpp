@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <list>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../algorithm.h"
+#include "../report.h"
+#include "../simd.h"
+
+#include "testbench.h"
+
+using namespace std;
+using namespace xp;
+
+namespace {
+	vector<uint8_t> random_codes(size_t n, size_t bytes) {
+		mt19937 g(42);
+		vector<uint8_t> v(n * bytes);
+		for (auto& x : v) x = uint8_t(g());
+		return v;
+	}
+
+	// every code compared to the query, then sorted.
+	vector<pair<size_t, size_t>> sorted_neighbors(const uint8_t* query, const vector<uint8_t>& codes, size_t bytes) {
+		vector<pair<size_t, size_t>> r;
+		for (size_t i = 0; i != codes.size() / bytes; ++i)
+			r.emplace_back(simd::bit_distance(query, codes.data() + i * bytes, bytes, simd::instruction_set::scalar), i);
+		sort(r.begin(), r.end());
+		return r;
+	}
+}
+
+TESTBENCH()
+
+TEST(check_hamming_distance) {
+	string s = "karolin";
+	string t = "kathrin";
+	VERIFY_EQ(3, hamming_distance(s.begin(), s.end(), t.begin()));
+	VERIFY_EQ(3, hamming_distance_n(s.begin(), 7, t.begin()));
+	VERIFY_EQ(2, hamming_distance_n(s.begin(), 4, t.begin()));
+
+	list<int> l {1, 0, 1, 1, 1, 0, 1};
+	vector<int> v {1, 0, 0, 1, 0, 0, 1};
+	VERIFY_EQ(2, hamming_distance(l.begin(), l.end(), v.begin()));
+	VERIFY_EQ(0, hamming_distance(l.begin(), l.end(), v.begin(), [](int x, int y) { return x >= y; }));
+}
+
+TEST(check_hamming_distance_on_arrays) {
+	vector<int> a(100);
+	vector<int> b(100);
+	for (int i = 0; i != 100; ++i) {
+		a[i] = i;
+		b[i] = i % 7 ? i : -i;
+	}
+	const int* first1 = a.data();
+	const int* last1 = first1 + a.size();
+	VERIFY_EQ(14, hamming_distance(first1, last1, b.data()));
+	VERIFY_EQ(14, hamming_distance(a.begin(), a.end(), b.begin()));
+	VERIFY_EQ(7, hamming_distance_n(a.data(), 50, b.data()));
+	VERIFY_EQ(7u, hamming_distance_n(first1, 50u, b.data()));
+
+	VERIFY(equal_n(a.data(), first1, 100));
+	VERIFY(equal_n(a.data(), b.data(), 1));
+	VERIFY(!equal_n(a.data(), b.data(), 100));
+	VERIFY(!equal_n(a.begin(), b.begin(), 100));
+}
+
+TEST(check_nearest_codes) {
+	for (size_t bytes : {8, 16, 20}) {
+		auto codes = random_codes(5000, bytes);
+		auto query = random_codes(1, bytes + 1);
+		auto expected = sorted_neighbors(query.data(), codes, bytes);
+		for (size_t k : {0, 1, 10, 5000, 6000}) {
+			vector<pair<size_t, size_t>> nearest;
+			nearest_codes(query.data(), codes.data(), 5000, bytes, k, back_inserter(nearest));
+			VERIFY_EQ(min(k, size_t(5000)), nearest.size());
+			VERIFY(equal(nearest.begin(), nearest.end(), expected.begin()));
+		}
+	}
+}
+
+TEST(check_parallel_nearest_codes) {
+	const size_t bytes = 16;
+	auto codes = random_codes(1 << 17, bytes);
+	// many codes at the same distance, so that the order of the ties is checked.
+	for (size_t i = 0; i < codes.size(); i += 3 * bytes)
+		fill_n(codes.begin() + i, bytes, uint8_t(0));
+	vector<uint8_t> query(bytes, uint8_t(1));
+	vector<pair<size_t, size_t>> expected, actual;
+	nearest_codes(query.data(), codes.data(), codes.size() / bytes, bytes, 100, back_inserter(expected));
+	nearest_codes(execution::par, query.data(), codes.data(), codes.size() / bytes, bytes, 100, back_inserter(actual));
+	VERIFY(expected == actual);
+	auto sorted = sorted_neighbors(query.data(), codes, bytes);
+	VERIFY(equal(expected.begin(), expected.end(), sorted.begin()));
+}
+
+TEST(bench_nearest_codes) {
+	// the 10 nearest of a million fingerprints of 128 bits.
+	const size_t bytes = 16;
+	const size_t n = 1 << 20;
+	auto codes = random_codes(n, bytes);
+	auto query = random_codes(1, bytes);
+	vector<pair<size_t, size_t>> nearest(10);
+
+	benchmark_options options;
+	options.sample_count = 10;
+	// all the distances computed without simd, then sorted.
+	auto sorted = run_benchmark<chrono::steady_clock>([&]() {
+		vector<pair<size_t, size_t>> all(n);
+		for (size_t i = 0; i != n; ++i)
+			all[i] = {simd::bit_distance(query.data(), codes.data() + i * bytes, bytes, simd::instruction_set::scalar), i};
+		partial_sort(all.begin(), all.begin() + 10, all.end());
+		return all[0];
+	}, options);
+	auto sequential = run_benchmark<chrono::steady_clock>([&]() { return nearest_codes(query.data(), codes.data(), n, bytes, 10, nearest.begin()); }, options);
+	auto parallel = run_benchmark<chrono::steady_clock>([&]() { return nearest_codes(execution::par, query.data(), codes.data(), n, bytes, 10, nearest.begin()); }, options);
+	cout << "    " << sorted.median.count() << " ns sorted, " << sequential.median.count() << " ns with a heap, " << parallel.median.count() << " ns in parallel" << endl;
+	REPORT("sorted", sorted);
+	REPORT("sequential", sequential);
+	REPORT("parallel", parallel);
+}
+
+TESTFIXTURE(hamming)
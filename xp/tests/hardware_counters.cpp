@@ -0,0 +1,83 @@
+#include <chrono>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+#include "../benchmark.h"
+#include "../hardware_counters.h"
+
+#include "testbench.h"
+
+using namespace xp;
+
+TESTBENCH()
+
+TEST(check_cycle_clock_is_monotonic) {
+	using namespace std;
+
+	auto t0 = cycle_clock::now();
+	vector<int> v(100000);
+	iota(v.begin(), v.end(), 0);
+	auto t1 = cycle_clock::now();
+
+	VERIFY(t0 < t1);
+	const char* sources[] = {"perf_events", "rdtsc", "steady"};
+	cout << "  source: " << sources[cycle_clock::source()] << ", ticks: " << (t1 - t0).count() << endl;
+}
+
+TEST(can_time_with_cycle_clock) {
+	using namespace std;
+
+	vector<int> v(100000);
+	timer<cycle_clock> t;
+	iota(v.begin(), v.end(), 0);
+	auto d = t.elapsed<cycle_clock::duration>();
+
+	VERIFY(d.count() > 0);
+}
+
+TEST(can_run_benchmark_with_cycle_clock) {
+	using namespace std;
+	using namespace std::chrono;
+
+	benchmark_options options;
+	options.sample_count = 10;
+	options.target = milliseconds(1);
+
+	vector<int> v(1000);
+	auto stats = run_benchmark<cycle_clock>([&]() { iota(v.begin(), v.end(), 0); }, options);
+	static_assert(is_same<decltype(stats.median), duration<double>>::value, "the durations are in ticks");
+
+	// a thousand writes take thousands of cycles, not the billions of cycles read as seconds.
+	VERIFY(stats.n + stats.outliers == 10u);
+	VERIFY(stats.median.count() > 0. && stats.median.count() < 1e6);
+	VERIFY(loop_overhead<cycle_clock>().count() < 1e3);
+	cout << "  median: " << stats.median.count() << " ticks" << endl;
+}
+
+TEST(can_count_hardware_events) {
+	using namespace std;
+
+	vector<int> v(100000);
+	counting_timer t;
+	iota(v.begin(), v.end(), 0);
+	auto counts = t.elapsed();
+
+	SKIP(!counts.has(hardware_event::instructions), "perf events are not permitted.");
+	VERIFY(counts[hardware_event::instructions] >= v.size());
+	cout << "  " << counts << ", ipc: " << counts.ipc() << endl;
+}
+
+TEST(check_unavailable_events_are_reported) {
+	event_counts x;
+	event_counts y;
+	x.available = 1u << hardware_event::cycles;
+	y.available = (1u << hardware_event::cycles) | (1u << hardware_event::instructions);
+	auto z = y - x;
+
+	VERIFY(z.has(hardware_event::cycles));
+	VERIFY(!z.has(hardware_event::instructions));
+	VERIFY_EQ(0., z.ipc());
+}
+
+TESTFIXTURE(hardware_counters)
@@ -0,0 +1,60 @@
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "../instrumented.h"
+
+#include "testbench.h"
+
+using namespace std;
+using namespace xp;
+
+TESTBENCH()
+
+TEST(can_count_operations) {
+	instrumented_base::reset();
+	{
+		instrumented<int> x {1};
+		instrumented<int> y = x;
+		VERIFY(x == y);
+	}
+	VERIFY_EQ(1u, instrumented_base::counts[instrumented_base::construct]);
+	VERIFY_EQ(1u, instrumented_base::counts[instrumented_base::copy_construct]);
+	VERIFY_EQ(1u, instrumented_base::counts[instrumented_base::equal]);
+	VERIFY_EQ(2u, instrumented_base::counts[instrumented_base::destruct]);
+}
+
+TEST(can_diff_snapshots) {
+	auto before = instrumented_base::snapshot();
+	vector<instrumented<int>> v {3, 1, 2};
+	sort(v.begin(), v.end());
+	auto after = instrumented_base::snapshot();
+	auto d = after - before;
+
+	VERIFY_EQ(3u, d[instrumented_base::construct]);
+	VERIFY(d[instrumented_base::compare] > 0);
+}
+
+TEST(check_counts_are_not_lost_across_threads) {
+	const int threads = 4;
+	const int n = 100000;
+
+	auto before = instrumented_base::snapshot();
+	vector<thread> workers;
+	for (int t = 0; t != threads; ++t) {
+		workers.emplace_back([]() {
+			instrumented<int> x {0};
+			instrumented<int> y {1};
+			for (int i = 0; i != n; ++i)
+				if (y < x) break;
+		});
+	}
+	for (auto& w : workers)
+		w.join();
+	auto d = instrumented_base::snapshot() - before;
+
+	VERIFY_EQ(uint64_t(threads) * n, d[instrumented_base::compare]);
+	VERIFY_EQ(uint64_t(threads) * 2, d[instrumented_base::destruct]);
+}
+
+TESTFIXTURE(instrumented)
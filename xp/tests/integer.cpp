@@ -19,4 +19,24 @@ TEST(can_lshift_natural) {
 	n <<= 36;
 }
 
+TEST(can_lshift_natural_across_words) {
+	natural a = 1;
+	a <<= 36;
+	natural b = 16;
+	b <<= 32;
+	VERIFY(a == b);
+
+	natural c = 1;
+	for (int i = 0; i != 36; ++i)
+		c += c;
+	VERIFY(a == c);
+
+	natural d = 3;
+	d <<= 31;
+	natural e = 3 << 29;
+	e <<= 2;
+	VERIFY(d == e);
+	VERIFY(!(d == a));
+}
+
 TESTFIXTURE(integer)
@@ -14,8 +14,8 @@ TEST(check_deferred) {
 		lazy<instrumented<int>> l {5};
 		auto& i = l.get();
 	}
-	VERIFY_EQ(1, instrumented_base::counts[instrumented_base::construct]);
-	VERIFY_EQ(1, instrumented_base::counts[instrumented_base::destruct]);
+	VERIFY_EQ(1u, instrumented_base::counts[instrumented_base::construct]);
+	VERIFY_EQ(1u, instrumented_base::counts[instrumented_base::destruct]);
 }
 
 TEST(check_deferred_do_not_instanciate_when_not_called) {
@@ -23,8 +23,8 @@ TEST(check_deferred_do_not_instanciate_when_not_called) {
 	{
 		lazy<instrumented<int>> l {5};
 	}
-	VERIFY_EQ(0, instrumented_base::counts[instrumented_base::construct]);
-	VERIFY_EQ(0, instrumented_base::counts[instrumented_base::destruct]);
+	VERIFY_EQ(0u, instrumented_base::counts[instrumented_base::construct]);
+	VERIFY_EQ(0u, instrumented_base::counts[instrumented_base::destruct]);
 }
 
 TEST(check_async) {
@@ -33,8 +33,8 @@ TEST(check_async) {
 		lazy<instrumented<int>> l {std::launch::async, 5};
 		auto& i = l.get(); // should not be necessary, async should block.
 	}
-	VERIFY_EQ(1, instrumented_base::counts[instrumented_base::construct]);
-	VERIFY_EQ(1, instrumented_base::counts[instrumented_base::destruct]);
+	VERIFY_EQ(1u, instrumented_base::counts[instrumented_base::construct]);
+	VERIFY_EQ(1u, instrumented_base::counts[instrumented_base::destruct]);
 }
 
 TESTFIXTURE(lazy)
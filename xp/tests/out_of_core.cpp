@@ -0,0 +1,76 @@
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <list>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "../out_of_core.h"
+#include "../report.h"
+
+#include "testbench.h"
+
+using namespace std;
+using namespace xp;
+
+namespace {
+	string to_stream(const vector<int>& v) {
+		ostringstream out;
+		copy(v.begin(), v.end(), ostream_iterator<int>(out, " "));
+		return out.str();
+	}
+}
+
+TESTBENCH()
+
+// the budget is a few elements, so that most of the input is spilled and mapped back.
+TEST(check_foldr_spilled_to_a_file) {
+	auto op = [](int x, int y) { return 2 * y - x; };
+	for (int n = 0; n != 40; ++n) {
+		vector<int> v(n);
+		iota(v.begin(), v.end(), 1);
+		int expected = foldr(v.begin(), v.end(), op, -1);
+
+		auto s = to_stream(v);
+		for (size_t k : {1, 3, 8, 100}) {
+			istringstream in(s);
+			VERIFY_EQ(expected, foldr(istream_iterator<int>(in), istream_iterator<int>(), op, -1, k * sizeof(int)));
+		}
+	}
+}
+
+TEST(check_foldr_within_a_budget) {
+	// not trivially copyable, so kept in memory whatever the budget.
+	istringstream in("a b c");
+	auto words = foldr(istream_iterator<string>(in), istream_iterator<string>(), [](const string& x, const string& y) { return y + x; }, string(), 1);
+	VERIFY_EQ(string("cba"), words);
+
+	// bidirectional, so folded backward without a copy.
+	list<int> l {1, 2, 3, 4, 5};
+	VERIFY_EQ(3, foldr(l.begin(), l.end(), minus<int>(), 0, 1));
+}
+
+TEST(bench_foldr_on_a_stream) {
+	vector<int> v(1 << 20);
+	for (size_t i = 0; i != v.size(); ++i) v[i] = int(i & 0xff);
+	auto s = to_stream(v);
+	auto fold = [&s](size_t budget) {
+		istringstream in(s);
+		return foldr(istream_iterator<int>(in), istream_iterator<int>(), [](int x, int y) { return x ^ (y * 3); }, 0, budget);
+	};
+	VERIFY_EQ(fold(v.size() * sizeof(int)), fold(1 << 16));
+
+	benchmark_options options;
+	options.sample_count = 10;
+	auto in_memory = run_benchmark<chrono::steady_clock>([&]() { return fold(v.size() * sizeof(int)); }, options);
+	auto spilled = run_benchmark<chrono::steady_clock>([&]() { return fold(1 << 16); }, options);
+	cout << "    " << in_memory.median.count() << " ns in memory, " << spilled.median.count() << " ns spilled in blocks of 64 KiB" << endl;
+	REPORT("in_memory", in_memory);
+	REPORT("spilled", spilled);
+}
+
+TESTFIXTURE(out_of_core)
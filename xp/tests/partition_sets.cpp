@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include "../algorithm.h"
+#include "../simd.h"
+
+#include "testbench.h"
+
+using namespace std;
+using namespace xp;
+
+namespace {
+	struct partition {
+		vector<int> only1;
+		vector<int> only2;
+		vector<int> both;
+
+		inline friend bool operator==(const partition& x, const partition& y) {
+			return x.only1 == y.only1 && x.only2 == y.only2 && x.both == y.both;
+		}
+	};
+
+	partition expected_partition(const vector<int>& a, const vector<int>& b) {
+		partition r;
+		set_difference(a.begin(), a.end(), b.begin(), b.end(), back_inserter(r.only1));
+		set_difference(b.begin(), b.end(), a.begin(), a.end(), back_inserter(r.only2));
+		set_intersection(a.begin(), a.end(), b.begin(), b.end(), back_inserter(r.both));
+		return r;
+	}
+
+	// n sorted values, each one of [0, 2n) with a probability of one half.
+	vector<int> random_set(size_t n, mt19937& g) {
+		vector<int> r;
+		for (int x = 0; r.size() < n; ++x) {
+			if (g() & 1) r.push_back(x);
+		}
+		return r;
+	}
+}
+
+TESTBENCH()
+
+TEST(check_partition_sets) {
+	vector<int> a {1, 2, 4, 6, 9};
+	vector<int> b {0, 2, 3, 6, 7, 9, 12};
+	partition r;
+	partition_sets(a.begin(), a.end(), b.begin(), b.end(), back_inserter(r.only1), back_inserter(r.only2), back_inserter(r.both));
+	VERIFY((r.only1 == vector<int>{1, 4}));
+	VERIFY((r.only2 == vector<int>{0, 3, 7, 12}));
+	VERIFY((r.both == vector<int>{2, 6, 9}));
+
+	partition l;
+	list<int> la(a.begin(), a.end());
+	partition_sets(la.begin(), la.end(), b.begin(), b.end(), back_inserter(l.only1), back_inserter(l.only2), back_inserter(l.both));
+	VERIFY(l == r);
+}
+
+TEST(check_partition_sets_for_each_strategy) {
+	mt19937 g(42);
+	for (size_t n1 : {0, 1, 7, 8, 9, 100, 1000}) {
+		for (size_t n2 : {0, 3, 8, 17, 100, 5000}) {
+			auto a = random_set(n1, g);
+			auto b = random_set(n2, g);
+			auto expected = expected_partition(a, b);
+
+			partition merged, galloped, by_blocks, automatic;
+			details::partition_sets_by_merge(a.begin(), a.end(), b.begin(), b.end(), back_inserter(merged.only1), back_inserter(merged.only2), back_inserter(merged.both), less<>());
+			details::partition_sets_by_galloping(a.begin(), a.end(), b.begin(), b.end(), back_inserter(galloped.only1), back_inserter(galloped.only2), back_inserter(galloped.both), less<>());
+			VERIFY(merged == expected);
+			VERIFY(galloped == expected);
+			for (int s = 0; s <= simd::instruction_set::best(); ++s) {
+				by_blocks = partition();
+				simd::partition_sets(a.data(), a.data() + a.size(), b.data(), b.data() + b.size(),
+					back_inserter(by_blocks.only1), back_inserter(by_blocks.only2), back_inserter(by_blocks.both), static_cast<simd::instruction_set::sets>(s));
+				VERIFY(by_blocks == expected);
+			}
+			partition_sets(a.data(), a.data() + a.size(), b.data(), b.data() + b.size(), back_inserter(automatic.only1), back_inserter(automatic.only2), back_inserter(automatic.both));
+			VERIFY(automatic == expected);
+		}
+	}
+}
+
+TEST(check_partition_sets_by_blocks_with_every_overlap) {
+	// the blocks of a and b are shifted by every amount, so that they pass each other at every position.
+	vector<int> a(64);
+	for (size_t i = 0; i != a.size(); ++i) a[i] = int(3 * i);
+	for (int shift = 0; shift != 30; ++shift) {
+		vector<int> b(40);
+		for (size_t i = 0; i != b.size(); ++i) b[i] = int(2 * i) + shift;
+		partition r;
+		simd::partition_sets(a.data(), a.data() + a.size(), b.data(), b.data() + b.size(), back_inserter(r.only1), back_inserter(r.only2), back_inserter(r.both));
+		VERIFY(r == expected_partition(a, b));
+	}
+}
+
+TEST(check_partition_unsorted_sets) {
+	vector<int> a {9, 1, 6, 4, 2};
+	vector<int> b {12, 3, 2, 9, 0, 7, 6};
+	partition r;
+	partition_unsorted_sets(a.begin(), a.end(), b.begin(), b.end(), back_inserter(r.only1), back_inserter(r.only2), back_inserter(r.both));
+	VERIFY((r.only1 == vector<int>{1, 4}));
+	VERIFY((r.only2 == vector<int>{12, 3, 0, 7}));
+	VERIFY((r.both == vector<int>{2, 9, 6}));
+}
+
+TESTFIXTURE(partition_sets)
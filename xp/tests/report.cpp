@@ -0,0 +1,87 @@
+#include <chrono>
+#include <sstream>
+
+#include "../benchmark.h"
+#include "../report.h"
+
+#include "testbench.h"
+
+using namespace xp;
+
+namespace {
+	statistics<std::chrono::nanoseconds> make_statistics(int mean, int stddev, std::size_t n) {
+		using std::chrono::nanoseconds;
+
+		statistics<nanoseconds> s {};
+		s.n = n;
+		s.min = s.p90 = s.p99 = s.max = s.median = s.mean = nanoseconds(mean);
+		s.stddev = s.mad = nanoseconds(stddev);
+		s.ci_lower = nanoseconds(mean - stddev);
+		s.ci_upper = nanoseconds(mean + stddev);
+		return s;
+	}
+}
+
+TESTBENCH()
+
+TEST(can_round_trip_json) {
+	benchmark_report r;
+	r.add("fixture", "test", "with \"quotes\"", make_statistics(100, 5, 30));
+	r.add("fixture", "test", "other", make_statistics(250, 10, 20));
+
+	std::stringstream ss;
+	r.write_json(ss);
+	auto x = benchmark_report::read_json(ss);
+
+	VERIFY_EQ(2u, x.size());
+	auto found = x.find(*r.begin());
+	VERIFY(found != nullptr);
+	VERIFY_EQ(100., found->stats.mean.count());
+	VERIFY_EQ(30u, found->stats.n);
+}
+
+TEST(can_round_trip_csv) {
+	benchmark_report r;
+	r.add("fixture", "test", "with, comma", make_statistics(100, 5, 30));
+
+	std::stringstream ss;
+	r.write_csv(ss);
+	auto x = benchmark_report::read_csv(ss);
+
+	VERIFY_EQ(1u, x.size());
+	VERIFY_EQ(std::string("with, comma"), x.begin()->scenario);
+	VERIFY_EQ(5., x.begin()->stats.stddev.count());
+}
+
+TEST(check_results_are_keyed) {
+	benchmark_report r;
+	r.add("fixture", "test", "scenario", make_statistics(100, 5, 30));
+	r.add("fixture", "test", "scenario", make_statistics(200, 5, 30));
+
+	VERIFY_EQ(1u, r.size());
+	VERIFY_EQ(200., r.begin()->stats.mean.count());
+}
+
+TEST(can_detect_regressions) {
+	benchmark_report baseline;
+	baseline.add("f", "t", "slower", make_statistics(100, 5, 30));
+	baseline.add("f", "t", "faster", make_statistics(100, 5, 30));
+	baseline.add("f", "t", "noise", make_statistics(100, 5, 30));
+	baseline.add("f", "t", "removed", make_statistics(100, 5, 30));
+
+	benchmark_report current;
+	current.add("f", "t", "slower", make_statistics(150, 5, 30));
+	current.add("f", "t", "faster", make_statistics(50, 5, 30));
+	current.add("f", "t", "noise", make_statistics(102, 5, 30));
+	current.add("f", "t", "added", make_statistics(100, 5, 30));
+
+	auto comparisons = compare(baseline, current);
+	VERIFY_EQ(3u, comparisons.size());
+
+	std::stringstream ss;
+	VERIFY_EQ(1u, print_regressions(ss, comparisons));
+	VERIFY(ss.str().find("REGRESSION f/t/slower") != std::string::npos);
+	VERIFY(ss.str().find("noise") == std::string::npos);
+}
+
+TESTFIXTURE(report)
@@ -0,0 +1,67 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "../report.h"
+#include "../scalability.h"
+
+#include "testbench.h"
+
+using namespace std;
+using namespace xp;
+
+TESTBENCH()
+
+TEST(check_start_barrier_releases_all_threads) {
+	const unsigned n = 4;
+	start_barrier barrier(n + 1);
+	atomic<unsigned> arrived {0};
+	atomic<unsigned> released {0};
+
+	vector<thread> threads;
+	for (unsigned i = 0; i != n; ++i) {
+		threads.emplace_back([&]() {
+			++arrived;
+			barrier.arrive_and_wait();
+			++released;
+		});
+	}
+	while (arrived != n)
+		this_thread::yield();
+	VERIFY_EQ(0u, released.load());
+
+	barrier.arrive_and_wait();
+	for (auto& t : threads)
+		t.join();
+	VERIFY_EQ(n, released.load());
+}
+
+TEST(can_make_thread_counts) {
+	auto counts = thread_counts(6);
+	VERIFY_EQ(4u, counts.size());
+	VERIFY_EQ(1u, counts.front());
+	VERIFY_EQ(4u, counts[2]);
+	VERIFY_EQ(6u, counts.back());
+}
+
+TEST(bench_scalability) {
+	benchmark_options options;
+	options.sample_count = 10;
+	options.target = chrono::milliseconds(1);
+
+	double x = 0.5;
+	auto points = run_scalability<chrono::steady_clock>([x]() { return sin(x); }, thread_counts(), options);
+
+	VERIFY_EQ(thread_counts().size(), points.size());
+	VERIFY_EQ(1., points.front().speedup);
+	for (auto& p : points) {
+		VERIFY_EQ(size_t(p.threads), p.thread_medians.size());
+		REPORT(to_string(p.threads) + " threads", p.latency);
+	}
+	print_scalability(cout, points);
+}
+
+TESTFIXTURE(scalability)
@@ -0,0 +1,391 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../algorithm.h"
+#include "../report.h"
+#include "../simd.h"
+
+#include "testbench.h"
+
+using namespace std;
+using namespace xp;
+
+namespace {
+	// Every position of a match, in ranges of every length up to 3 vectors of 32 bytes,
+	// is compared to the scalar version, for every supported instruction set.
+	template<typename T>
+	bool check_find() {
+		const size_t size = 3 * 32 / sizeof(T) + 3;
+		for (int s = 0; s <= simd::instruction_set::best(); ++s) {
+			auto isa = static_cast<simd::instruction_set::sets>(s);
+			for (size_t n = 0; n <= size; ++n) {
+				for (size_t i = 0; i <= n; ++i) {
+					vector<T> v(n, T(1));
+					if (i != n) v[i] = T(2);
+					if (i + 2 < n) v[i + 2] = T(2);
+					const T* first = v.data();
+					const T* last = v.data() + n;
+					if (simd::find(first, last, T(2), isa) != std::find(first, last, T(2))) return false;
+					auto expected = i + 2 < n ? first + i + 2 : i != n ? first + i : last;
+					if (simd::find_backward(first, last, T(2), isa) != expected) return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	// Runs of random lengths, in ranges of every length up to 3 vectors of 32 bytes, are counted and encoded
+	// as the scalar version does on the iterators of the vector, for every supported instruction set.
+	template<typename T>
+	bool check_runs() {
+		const size_t size = 3 * 32 / sizeof(T) + 3;
+		mt19937 g(42);
+		for (int s = 0; s <= simd::instruction_set::best(); ++s) {
+			auto isa = static_cast<simd::instruction_set::sets>(s);
+			for (size_t n = 0; n <= size; ++n) {
+				for (int max_run : {1, 3, 40}) {
+					vector<T> v;
+					for (T x = T(1); v.size() < n; x = T(x + 1))
+						v.insert(v.end(), min<size_t>(n - v.size(), 1 + g() % max_run), x);
+					const T* first = v.data();
+					const T* last = first + n;
+
+					auto runs = unique_count(v.begin(), v.end());
+					if (simd::count_runs(first, last, isa) != size_t(runs)) return false;
+
+					vector<pair<ptrdiff_t, T>> expected;
+					unique_copy_with_count(v.begin(), v.end(), back_inserter(expected));
+					vector<pair<ptrdiff_t, T>> encoded(runs + 1);
+					if (simd::run_length_encode(first, last, encoded.data(), isa) != encoded.data() + runs) return false;
+					if (!equal(expected.begin(), expected.end(), encoded.begin())) return false;
+
+					if (n && simd::find_not(first, last, v[0], isa) != first + expected[0].first) return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	// ranges of every length up to 3 vectors of 32 bytes, for every supported instruction set.
+	template<typename T>
+	bool check_reverse() {
+		const size_t size = 3 * 32 / sizeof(T) + 3;
+		for (int s = 0; s <= simd::instruction_set::best(); ++s) {
+			auto isa = static_cast<simd::instruction_set::sets>(s);
+			for (size_t n = 0; n <= size; ++n) {
+				vector<T> v(n);
+				for (size_t i = 0; i != n; ++i) v[i] = T(i + 1);
+				auto expected = v;
+				std::reverse(expected.begin(), expected.end());
+				simd::reverse(v.data(), v.data() + n, isa);
+				if (v != expected) return false;
+			}
+		}
+		return true;
+	}
+
+	// the mismatches at every position, in ranges of every length up to 3 vectors of 32 bytes, for every supported instruction set.
+	template<typename T>
+	bool check_mismatches() {
+		const size_t size = 3 * 32 / sizeof(T) + 3;
+		for (int s = 0; s <= simd::instruction_set::best(); ++s) {
+			auto isa = static_cast<simd::instruction_set::sets>(s);
+			for (size_t n = 0; n <= size; ++n) {
+				vector<T> a(n, T(1));
+				for (size_t i = 0; i <= n; ++i) {
+					auto b = a;
+					if (i != n) b[i] = T(2);
+					if (i + 3 < n) b[i + 3] = T(0);
+					const T* last = a.data() + n;
+					auto expected = i == n ? 0u : i + 3 < n ? 2u : 1u;
+					if (simd::count_mismatches(a.data(), last, b.data(), isa) != expected) return false;
+					if (simd::mismatch(a.data(), last, b.data(), isa) != a.data() + i) return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	// the number of bits set in each of the n bytes at a and b, one byte at a time.
+	size_t bit_distance_by_bytes(const uint8_t* a, const uint8_t* b, size_t n) {
+		size_t r = 0;
+		for (size_t i = 0; i != n; ++i) {
+			for (unsigned x = a[i] ^ b[i]; x; x &= x - 1) ++r;
+		}
+		return r;
+	}
+
+	// hint, hint + 1, hint - 1, hint + 2, hint - 2, ...
+	template<typename T>
+	const T* find_nearest(const T* first, const T* last, const T* hint, T val) {
+		for (ptrdiff_t d = 0; hint - d >= first || hint + d < last; ++d) {
+			if (d && hint + d < last && hint[d] == val) return hint + d;
+			if (hint - d >= first && hint[-d] == val) return hint - d;
+		}
+		return last;
+	}
+}
+
+TESTBENCH()
+
+TEST(check_find_for_each_type) {
+	cout << "    best instruction set: " << simd::instruction_set::name(simd::instruction_set::best()) << endl;
+	VERIFY(check_find<char>());
+	VERIFY(check_find<unsigned char>());
+	VERIFY(check_find<short>());
+	VERIFY(check_find<int>());
+	VERIFY(check_find<unsigned>());
+	VERIFY(check_find<long long>());
+	VERIFY(check_find<float>());
+	VERIFY(check_find<double>());
+}
+
+TEST(check_find_compares_floating_points_as_values) {
+	vector<double> v {1., -0., numeric_limits<double>::quiet_NaN(), 4., 5.};
+	auto first = v.data();
+	auto last = first + v.size();
+	for (int s = 0; s <= simd::instruction_set::best(); ++s) {
+		auto isa = static_cast<simd::instruction_set::sets>(s);
+		VERIFY(simd::find(first, last, 0., isa) == first + 1);
+		VERIFY(simd::find(first, last, numeric_limits<double>::quiet_NaN(), isa) == last);
+	}
+}
+
+TEST(check_algorithms_dispatch_to_simd) {
+	vector<int> v {1, 2, 3, 4, 5, 3, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17};
+	int* first = v.data();
+	int* last = first + v.size();
+
+	VERIFY(find_backward(first, last, 3) == first + 5);
+	VERIFY(find_backward(first, last, 42) == last);
+	VERIFY(find_backward(v.cbegin(), v.cend(), 3) == v.cbegin() + 5);
+
+	auto found = find_n(first, v.size(), 3);
+	VERIFY(found.first == first + 2);
+	VERIFY_EQ(v.size() - 2, found.second);
+	found = find_n(first, v.size(), 42);
+	VERIFY(found.first == last);
+	VERIFY_EQ(0u, found.second);
+
+	// the type of the value differs, not vectorized
+	VERIFY(find_backward(first, last, 3L) == first + 5);
+}
+
+TEST(check_runs_for_each_type) {
+	VERIFY(check_runs<char>());
+	VERIFY(check_runs<unsigned char>());
+	VERIFY(check_runs<short>());
+	VERIFY(check_runs<int>());
+	VERIFY(check_runs<unsigned>());
+	VERIFY(check_runs<long long>());
+	VERIFY(check_runs<float>());
+	VERIFY(check_runs<double>());
+}
+
+TEST(check_runs_of_floating_points) {
+	const double nan = numeric_limits<double>::quiet_NaN();
+	vector<double> v(40, 1.);
+	v[3] = nan;
+	v[4] = nan;
+	v[10] = -0.;
+	v[11] = 0.;
+	const double* first = v.data();
+	const double* last = first + v.size();
+	for (int s = 0; s <= simd::instruction_set::best(); ++s) {
+		auto isa = static_cast<simd::instruction_set::sets>(s);
+		VERIFY_EQ(6u, simd::count_runs(first, last, isa));
+		vector<pair<int, double>> encoded(6);
+		VERIFY(simd::run_length_encode(first, last, encoded.data(), isa) == encoded.data() + 6);
+		VERIFY_EQ(3, encoded[0].first);
+		VERIFY_EQ(1, encoded[1].first);
+		VERIFY_EQ(1, encoded[2].first);
+		VERIFY_EQ(2, encoded[4].first);
+		VERIFY_EQ(28, encoded[5].first);
+	}
+}
+
+TEST(check_run_algorithms_dispatch_to_simd) {
+	vector<int> v {0, 11, 33, 33, 44, 66, 66, 77, 88, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 1};
+	int* first = v.data();
+	int* last = first + v.size();
+
+	VERIFY_EQ(9, unique_count(first, last));
+	VERIFY_EQ(0, unique_count(first, first));
+
+	auto r = count_while_adjacent(first + 9, last);
+	VERIFY_EQ(12, r.first);
+	VERIFY(r.second == last - 1);
+	VERIFY_EQ(0, count_while_adjacent(last, last).first);
+
+	pair<unsigned short, int> encoded[9];
+	VERIFY(unique_copy_with_count(first, last, encoded) == encoded + 9);
+	VERIFY_EQ(2, encoded[2].first);
+	VERIFY_EQ(33, encoded[2].second);
+	VERIFY_EQ(12, encoded[7].first);
+	VERIFY_EQ(1, encoded[8].second);
+
+	vector<pair<unsigned short, int>> inserted;
+	unique_copy_with_count(first, last, back_inserter(inserted));
+	VERIFY(equal(inserted.begin(), inserted.end(), encoded));
+}
+
+TEST(check_reverse_for_each_type) {
+	VERIFY(check_reverse<char>());
+	VERIFY(check_reverse<short>());
+	VERIFY(check_reverse<int>());
+	VERIFY(check_reverse<float>());
+	VERIFY(check_reverse<long long>());
+	VERIFY(check_reverse<double>());
+	VERIFY(check_reverse<unsigned char>());
+}
+
+TEST(check_mismatches_for_each_type) {
+	VERIFY(check_mismatches<char>());
+	VERIFY(check_mismatches<unsigned char>());
+	VERIFY(check_mismatches<short>());
+	VERIFY(check_mismatches<int>());
+	VERIFY(check_mismatches<long long>());
+	VERIFY(check_mismatches<float>());
+	VERIFY(check_mismatches<double>());
+}
+
+TEST(check_bit_distances) {
+	mt19937 g(42);
+	vector<uint8_t> codes(100 * 72);
+	for (auto& x : codes) x = uint8_t(g());
+	vector<uint8_t> query(72);
+	for (auto& x : query) x = uint8_t(g());
+	for (size_t bytes : {1, 7, 8, 16, 24, 32, 40, 72}) {
+		for (size_t n : {0, 1, 3, 4, 5, 99}) {
+			vector<uint32_t> expected(n), distances(n);
+			for (size_t i = 0; i != n; ++i)
+				expected[i] = uint32_t(bit_distance_by_bytes(query.data(), codes.data() + i * bytes, bytes));
+			for (int s = 0; s <= simd::instruction_set::best(); ++s) {
+				auto isa = static_cast<simd::instruction_set::sets>(s);
+				VERIFY(simd::bit_distances(query.data(), codes.data(), n, bytes, distances.data(), isa) == distances.data() + n);
+				VERIFY(distances == expected);
+				if (n) VERIFY_EQ(size_t(expected[0]), simd::bit_distance(query.data(), codes.data(), bytes, isa));
+			}
+		}
+	}
+}
+
+TEST(check_find_with_hint_by_blocks) {
+	vector<int> v(1000);
+	mt19937 g {1664};
+	for (auto& x : v) x = uniform_int_distribution<int>(0, 300)(g);
+	const int* first = v.data();
+	const int* last = first + v.size();
+
+	for (int val = 0; val <= 301; val += 7) {
+		for (size_t h = 0; h < v.size(); h += 13) {
+			auto expected = find_nearest(first, last, first + h, val);
+			VERIFY(find(first, last, first + h, val) == expected);
+			VERIFY(find_if(first, last, first + h, [=](int x) { return x == val; }) == expected);
+		}
+	}
+}
+
+TEST(bench_find_with_hint) {
+	vector<int> v(1 << 20);
+	iota(v.begin(), v.end(), 0);
+	int* first = v.data();
+	int* last = first + v.size();
+	int* hint = first + v.size() / 2;
+
+	benchmark_options options;
+	options.sample_count = 10;
+	for (int distance : {10, 1000, 100000}) {
+		int val = *hint + distance;
+		auto blocks = run_benchmark<chrono::steady_clock>([&]() { return find(first, last, hint, val); }, options);
+		auto elements = run_benchmark<chrono::steady_clock>([&]() { return find(v.begin(), v.end(), v.begin() + (hint - first), val); }, options);
+		cout << "    distance " << distance << ": " << blocks.median.count() << " ns by blocks, " << elements.median.count() << " ns by elements" << endl;
+		REPORT("blocks/" + to_string(distance), blocks);
+		REPORT("elements/" + to_string(distance), elements);
+	}
+}
+
+TEST(bench_find_backward) {
+	vector<int> v(1 << 20);
+	for (size_t i = 0; i != v.size(); ++i)
+		v[i] = int(i % 1000);
+	v[0] = -1;
+	const int* first = v.data();
+	const int* last = first + v.size();
+
+	benchmark_options options;
+	options.sample_count = 10;
+	for (int s = 0; s <= simd::instruction_set::best(); ++s) {
+		auto isa = static_cast<simd::instruction_set::sets>(s);
+		auto stats = run_benchmark<chrono::steady_clock>([&]() { return simd::find_backward(first, last, -1, isa); }, options);
+		cout << "    " << simd::instruction_set::name(isa) << ": " << stats.median.count() << " ns" << endl;
+		REPORT(simd::instruction_set::name(isa), stats);
+	}
+}
+
+// runs of 1 to 16 elements, the boundaries hard to predict.
+TEST(bench_run_length_encode) {
+	vector<int> v;
+	mt19937 g(42);
+	for (int x = 0; v.size() < (1 << 20); ++x)
+		v.insert(v.end(), 1 + g() % 16, x);
+	const int* first = v.data();
+	const int* last = first + v.size();
+	vector<pair<int, int>> encoded(v.size());
+
+	benchmark_options options;
+	options.sample_count = 10;
+	for (int s = 0; s <= simd::instruction_set::best(); ++s) {
+		auto isa = static_cast<simd::instruction_set::sets>(s);
+		auto count = run_benchmark<chrono::steady_clock>([&]() { return simd::count_runs(first, last, isa); }, options);
+		auto encode = run_benchmark<chrono::steady_clock>([&]() { return simd::run_length_encode(first, last, encoded.data(), isa); }, options);
+		cout << "    " << simd::instruction_set::name(isa) << ": " << count.median.count() << " ns to count, " << encode.median.count() << " ns to encode" << endl;
+		REPORT(string("count/") + simd::instruction_set::name(isa), count);
+		REPORT(string("encode/") + simd::instruction_set::name(isa), encode);
+	}
+}
+
+TEST(bench_reverse) {
+	vector<short> v(1 << 20);
+	iota(v.begin(), v.end(), short(0));
+
+	benchmark_options options;
+	options.sample_count = 10;
+	for (int s = 0; s <= simd::instruction_set::best(); ++s) {
+		auto isa = static_cast<simd::instruction_set::sets>(s);
+		auto stats = run_benchmark<chrono::steady_clock>([&]() { simd::reverse(v.data(), v.data() + v.size(), isa); return v[0]; }, options);
+		cout << "    " << simd::instruction_set::name(isa) << ": " << stats.median.count() << " ns" << endl;
+		REPORT(simd::instruction_set::name(isa), stats);
+	}
+}
+
+TEST(bench_bit_distances) {
+	// 32 MB of fingerprints of 64 and of 256 bits.
+	mt19937_64 g(42);
+	vector<uint64_t> codes(1 << 22);
+	for (auto& x : codes) x = g();
+	auto bytes = reinterpret_cast<const uint8_t*>(codes.data());
+	vector<uint32_t> distances(codes.size());
+
+	benchmark_options options;
+	options.sample_count = 10;
+	for (size_t size : {8, 32}) {
+		for (int s = 0; s <= simd::instruction_set::best(); ++s) {
+			auto isa = static_cast<simd::instruction_set::sets>(s);
+			auto stats = run_benchmark<chrono::steady_clock>([&]() { return simd::bit_distances(bytes, bytes, codes.size() * 8 / size, size, distances.data(), isa); }, options);
+			cout << "    " << size << " bytes, " << simd::instruction_set::name(isa) << ": " << stats.median.count() << " ns" << endl;
+			REPORT(to_string(size) + "/" + simd::instruction_set::name(isa), stats);
+		}
+	}
+}
+
+TESTFIXTURE(simd)
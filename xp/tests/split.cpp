@@ -1,10 +1,18 @@
+#include <atomic>
+#include <chrono>
 #include <iostream>
+#include <iterator>
+#include <list>
+#include <random>
+#include <string>
 #include <utility>
 #include <vector>
 
 using std::vector;
 
 #include "../fakeconcepts.h"
+#include "../algorithm.h"
+#include "../report.h"
 
 #include "testbench.h"
 
@@ -67,12 +75,12 @@ find_if_searcher<Pred> make_find_if_searcher(Pred&& pred) {
 	return find_if_searcher<Pred>{std::forward<Pred>(pred)};
 }
 
-template<ForwardIterator I, typename C = std::iterator_traits<I>::iterator_category>
+template<ForwardIterator I, typename C = typename std::iterator_traits<I>::iterator_category>
 I cbegin(const std::pair<I, I>& r) {
 	return r.first;
 }
 
-template<ForwardIterator I, typename C = std::iterator_traits<I>::iterator_category>
+template<ForwardIterator I, typename C = typename std::iterator_traits<I>::iterator_category>
 I cend(const std::pair<I, I>& r) {
 	return r.second;
 }
@@ -91,6 +99,27 @@ F split(I first, I last, S& s, F f) {
 	return f;
 }
 
+// the chunks as strings.
+struct collect {
+	vector<std::string>* chunks;
+
+	template<typename I>
+	void operator()(I first, I last) {
+		chunks->emplace_back(first, last);
+	}
+};
+
+// lines of random words, as in a log file.
+std::string make_log(std::size_t size) {
+	std::mt19937 g(42);
+	std::string r;
+	while (r.size() < size) {
+		r.append(1 + g() % 12, char('a' + g() % 26));
+		r += g() % 8 ? ' ' : '\n';
+	}
+	return r;
+}
+
 TESTBENCH()
 
 TEST(check_split) {
@@ -110,4 +139,95 @@ TEST(check_search) {
 	VERIFY_EQ(5, std::distance(found.second, cend(v)));
 }
 
+TEST(check_split_n) {
+	std::string s = "a,bb,,c,";
+	vector<std::string> chunks;
+	xp::split_n(s.begin(), s.size(), ',', collect{ &chunks });
+	VERIFY((chunks == vector<std::string>{ "a", "bb", "", "c", "" }));
+
+	chunks.clear();
+	xp::split_n(s.begin(), 4, ',', collect{ &chunks });
+	VERIFY((chunks == vector<std::string>{ "a", "bb" }));
+}
+
+TEST(check_split_on_arrays) {
+	std::string s = make_log(1000) + " ";
+	std::list<char> l(s.begin(), s.end());
+	vector<std::string> expected, actual;
+	xp::split(l.begin(), l.end(), ' ', collect{ &expected });
+	xp::split(s.data(), s.data() + s.size(), ' ', collect{ &actual });
+	VERIFY(expected == actual);
+	VERIFY(expected.back().empty());
+
+	actual.clear();
+	xp::split(s.data(), s.data(), ' ', collect{ &actual });
+	VERIFY_EQ(1u, actual.size());
+}
+
+TEST(check_split_ranges_are_views) {
+	std::string s = "a,bb,,c";
+	const char* first = s.data();
+	vector<xp::bounded_range<const char*>> ranges;
+	xp::split_ranges(first, first + s.size(), ',', std::back_inserter(ranges));
+	VERIFY_EQ(4u, ranges.size());
+	VERIFY(ranges[1].first == first + 2);
+	VERIFY(ranges[1].last == first + 4);
+	VERIFY(xp::empty(ranges[2]));
+}
+
+TEST(check_parallel_split) {
+	std::string s = make_log(1 << 18);
+	const char* first = s.data();
+	const char* last = first + s.size();
+
+	vector<xp::bounded_range<const char*>> expected, actual;
+	xp::split_ranges(first, last, '\n', std::back_inserter(expected));
+	xp::split_ranges(xp::execution::par, first, last, '\n', std::back_inserter(actual));
+	VERIFY(expected == actual);
+
+	std::atomic<std::size_t> chunks(0), bytes(0);
+	xp::split(xp::execution::par, first, last, ' ', [&](const char* f, const char* l) {
+		++chunks;
+		bytes += l - f;
+	});
+	VERIFY_EQ(std::size_t(std::count(first, last, ' ') + 1), chunks.load());
+	VERIFY_EQ(std::size_t(s.size() - chunks + 1), bytes.load());
+
+	chunks = 0;
+	xp::split_if(xp::execution::par, s.begin(), s.end(), [](char c) { return c == ' ' || c == '\n'; }, [&](std::string::iterator, std::string::iterator) {
+		++chunks;
+	});
+	VERIFY_EQ(std::size_t(std::count(first, last, ' ') + std::count(first, last, '\n') + 1), chunks.load());
+}
+
+TEST(bench_split) {
+	std::string s = make_log(1 << 22);
+	const char* first = s.data();
+	const char* last = first + s.size();
+	auto count_chunks = [](std::size_t& n) { return [&n](const char*, const char*) { ++n; }; };
+
+	xp::benchmark_options options;
+	options.sample_count = 10;
+	auto by_find = xp::run_benchmark<std::chrono::steady_clock>([&]() {
+		std::size_t n = 0;
+		xp::split_if(first, last, [](char c) { return c == ' '; }, count_chunks(n));
+		return n;
+	}, options);
+	auto by_masks = xp::run_benchmark<std::chrono::steady_clock>([&]() {
+		std::size_t n = 0;
+		xp::split(first, last, ' ', count_chunks(n));
+		return n;
+	}, options);
+	auto parallel = xp::run_benchmark<std::chrono::steady_clock>([&]() {
+		std::atomic<std::size_t> n(0);
+		xp::split(xp::execution::par, first, last, '\n', [&n](const char*, const char*) { ++n; });
+		return n.load();
+	}, options);
+	std::cout << "    " << by_find.median.count() << " ns by find_if, " << by_masks.median.count() << " ns by masks, "
+		<< parallel.median.count() << " ns in parallel (lines)" << std::endl;
+	REPORT("find_if", by_find);
+	REPORT("masks", by_masks);
+	REPORT("parallel", parallel);
+}
+
 TESTFIXTURE(split)
@@ -0,0 +1,43 @@
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <vector>
+
+#include "../temporary_file.h"
+
+#include "testbench.h"
+
+using namespace std;
+using namespace xp;
+
+TESTBENCH()
+
+TEST(can_map_what_was_appended) {
+	// larger than a page, so that the views start in the middle of one.
+	vector<uint32_t> v(5000);
+	iota(v.begin(), v.end(), 0u);
+
+	temporary_file file;
+	file.append(v.data(), 1000 * sizeof(uint32_t));
+	file.append(v.data() + 1000, (v.size() - 1000) * sizeof(uint32_t));
+	VERIFY_EQ(v.size() * sizeof(uint32_t), file.size());
+
+	for (size_t first : {0, 1, 1023, 1024, 3001}) {
+		size_t n = v.size() - first;
+		auto view = file.map(first * sizeof(uint32_t), n * sizeof(uint32_t));
+		VERIFY(memcmp(view.data(), v.data() + first, n * sizeof(uint32_t)) == 0);
+	}
+}
+
+TEST(can_map_while_appending) {
+	temporary_file file;
+	uint64_t x = 42;
+	file.append(&x, sizeof(x));
+	auto view = file.map(0, sizeof(x));
+	x = 43;
+	file.append(&x, sizeof(x));
+	VERIFY_EQ(42u, *static_cast<const uint64_t*>(view.data()));
+	VERIFY_EQ(43u, *static_cast<const uint64_t*>(file.map(sizeof(x), sizeof(x)).data()));
+}
+
+TESTFIXTURE(temporary_file)
@@ -43,13 +43,20 @@ private:
 class testing_bench {
 	friend struct fixture;
 	std::vector<typename std::reference_wrapper<const fixture>> fixtures;
+	std::string fixture_name;
+	std::string test_name;
 
 	static void run(const fixture& f, size_t& pass, size_t& fail) {
+		instance.fixture_name = f.name;
 		f(pass, fail);
 	}
 	static testing_bench instance;
 
 public:
+	// the names of the running fixture and test, used to key the benchmark results.
+	static const std::string& current_fixture() { return instance.fixture_name; }
+	static const std::string& current_test() { return instance.test_name; }
+	static void enter(const char* test) { instance.test_name = test; }
 
 	static void run(const char* fixture_name, size_t& pass, size_t& fail) {
 		std::string name = fixture_name;
@@ -81,6 +88,7 @@ struct testrange {\
 		testcase<begin> c;\
 		if(c.name()) {\
 			std::cout << "Running " << c.name() << std::endl;\
+			testing_bench::enter(c.name());\
 			try {\
 				c.run();\
 				++pass; \
@@ -116,6 +124,9 @@ if(!(___e == ___a)) { \
 	msg << POS "VERIFY_EQ("#expected","#actual") => (" << ___e << ")!=(" << ___a << ")"; \
 	throw std::logic_error(msg.str()); \
 }}
+#define REPORT(scenario, stats) \
+xp::benchmark_report::global().add(testing_bench::current_fixture(), testing_bench::current_test(), scenario, stats)
+
 #define SKIP(expr, reason) \
 { auto ___e = (expr); if(___e) { std::cout << "SKIP: " << reason << std::endl; return; } }
 
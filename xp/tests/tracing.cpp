@@ -0,0 +1,75 @@
+#define XP_TRACING
+#include "../tracing.h"
+
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "testbench.h"
+
+using namespace std;
+using namespace xp;
+
+namespace {
+	size_t occurrences(const string& s, const string& pattern) {
+		size_t n = 0;
+		for (auto pos = s.find(pattern); pos != string::npos; pos = s.find(pattern, pos + 1))
+			++n;
+		return n;
+	}
+}
+
+TESTBENCH()
+
+TEST(can_trace_zones) {
+	trace_registry::global().clear();
+	{
+		XP_TRACE_ZONE("outer");
+		XP_TRACE_ZONE("inner");
+	}
+	thread([]() { XP_TRACE_ZONE("worker"); }).join();
+
+	ostringstream os;
+	VERIFY_EQ(0u, trace_registry::global().write_chrome_trace(os));
+	auto json = os.str();
+	VERIFY_EQ(1u, occurrences(json, "\"name\":\"outer\""));
+	VERIFY_EQ(1u, occurrences(json, "\"name\":\"inner\""));
+	VERIFY_EQ(1u, occurrences(json, "\"name\":\"worker\""));
+	VERIFY_EQ(3u, occurrences(json, "\"ph\":\"X\""));
+}
+
+TEST(check_disabled_zones_are_not_recorded) {
+	trace_registry::global().clear();
+	{
+		trace_zone_disabled z("disabled");
+		trace_zone e("enabled");
+	}
+
+	ostringstream os;
+	trace_registry::global().write_chrome_trace(os);
+	VERIFY_EQ(0u, occurrences(os.str(), "\"name\":\"disabled\""));
+	VERIFY_EQ(1u, occurrences(os.str(), "\"name\":\"enabled\""));
+}
+
+TEST(check_full_buffer_drops_the_oldest_zones) {
+	trace_registry::global().clear();
+	auto n = trace_buffer::capacity + 10;
+	for (size_t i = 0; i != n; ++i) {
+		XP_TRACE_ZONE("zone");
+	}
+
+	ostringstream os;
+	VERIFY_EQ(10u, trace_registry::global().write_chrome_trace(os));
+	VERIFY_EQ(trace_buffer::capacity, occurrences(os.str(), "\"name\":\"zone\""));
+}
+
+TEST(check_clear_forgets_the_exited_threads) {
+	thread([]() { XP_TRACE_ZONE("worker"); }).join();
+	trace_registry::global().clear();
+
+	ostringstream os;
+	trace_registry::global().write_chrome_trace(os);
+	VERIFY_EQ(0u, occurrences(os.str(), "\"name\""));
+}
+
+TESTFIXTURE(tracing)
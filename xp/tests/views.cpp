@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <chrono>
+#include <forward_list>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../algorithm.h"
+#include "../report.h"
+#include "../views.h"
+
+#include "testbench.h"
+
+using namespace std;
+using namespace xp;
+
+namespace {
+	vector<int> random_values(size_t n) {
+		mt19937 g(42);
+		uniform_int_distribution<int> d(-1000, 1000);
+		vector<int> v(n);
+		for (auto& x : v) x = d(g);
+		return v;
+	}
+
+	bool is_even(int x) {
+		return (x & 1) == 0;
+	}
+}
+
+TESTBENCH()
+
+TEST(check_stages) {
+	vector<int> v {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+	vector<int> r;
+	views::copy(views::from(v) | views::filter(is_even) | views::transform([](int x) { return x * x; }), back_inserter(r));
+	VERIFY((r == vector<int>{4, 16, 36, 64, 100}));
+
+	r.clear();
+	views::copy(views::from(v) | views::take_while([](int x) { return x < 6; }), back_inserter(r));
+	VERIFY((r == vector<int>{1, 2, 3, 4, 5}));
+
+	r.clear();
+	views::copy(views::from(v) | views::stride(3), back_inserter(r));
+	VERIFY((r == vector<int>{1, 4, 7, 10}));
+
+	// the stages apply in order: the stride is taken on the even values.
+	r.clear();
+	views::copy(views::from(v) | views::filter(is_even) | views::stride(2) | views::take_while([](int x) { return x < 10; }), back_inserter(r));
+	VERIFY((r == vector<int>{2, 6}));
+}
+
+TEST(check_sources) {
+	int a[] {5, 4, 3, 2, 1};
+	VERIFY_EQ(15, views::foldl(views::from(a), plus<>(), 0));
+	VERIFY_EQ(9, views::foldl(views::from(make_bounded_range(a + 1, a + 4)), plus<>(), 0));
+	VERIFY_EQ(12, views::foldl(views::from(make_counted_range(a, 3)), plus<>(), 0));
+	VERIFY_EQ(12, views::foldl(views::from(guarded_range<int*, bool(*)(int*)>(a, [](int* p) { return *p > 2; })), plus<>(), 0));
+
+	forward_list<string> l {"a", "bb", "ccc"};
+	VERIFY_EQ(3u, views::count(views::from(l)));
+	VERIFY_EQ(string("abbccc"), views::foldl(views::from(l), plus<>(), string()));
+
+	// the elements are references to the range.
+	vector<int> v {1, 2, 3};
+	views::for_each(views::from(v) | views::filter(is_even), [](int& x) { x = 0; });
+	VERIFY((v == vector<int>{1, 0, 3}));
+}
+
+TEST(check_zip) {
+	vector<int> prices {10, 20, 30, 40};
+	int quantities[] {1, 0, 3};
+	auto v = views::zip(prices, quantities) | views::transform([](pair<int&, int&> x) { return x.first * x.second; });
+	VERIFY_EQ(100, views::foldl(v, plus<>(), 0));
+	VERIFY_EQ(3u, views::count(v));
+	VERIFY_EQ(2u, views::count(views::zip(make_counted_range(prices.begin(), 2), prices)));
+}
+
+TEST(check_chunk) {
+	vector<int> v {1, 2, 3, 4, 5, 6, 7};
+	vector<int> sums;
+	auto sum = [](counted_range<vector<int>::iterator> r) { return accumulate(r.begin(), r.begin() + r.size(), 0); };
+	views::copy(views::chunk(v, 3) | views::transform(sum), back_inserter(sums));
+	VERIFY((sums == vector<int>{6, 15, 7}));
+	VERIFY_EQ(0u, views::count(views::chunk(make_counted_range(v.begin(), 0), 3)));
+
+	forward_list<int> l(v.begin(), v.end());
+	vector<ptrdiff_t> sizes;
+	views::copy(views::chunk(l, 2) | views::transform([](counted_range<forward_list<int>::iterator> r) { return r.size(); }), back_inserter(sizes));
+	VERIFY((sizes == vector<ptrdiff_t>{2, 2, 2, 1}));
+}
+
+TEST(check_views_are_lazy) {
+	int calls = 0;
+	vector<int> v(1000, 1);
+	auto view = views::from(v) | views::transform([&calls](int x) { ++calls; return x; }) | views::take_while([](int) { return false; });
+	VERIFY_EQ(0, calls);
+	VERIFY_EQ(0u, views::count(view));
+	VERIFY_EQ(1, calls);
+}
+
+TEST(bench_views) {
+	// an ETL step: the sum of the squares of the even values, clamped.
+	auto v = random_values(1 << 22);
+	// lambdas, since a stage holding a pointer to function may not be inlined.
+	auto even = [](int x) { return is_even(x); };
+	auto square = [](int x) { return x * x; };
+	auto clamp = [](int x) { return std::min(x, 250000); };
+
+	auto by_hand = [&]() {
+		long long total = 0;
+		for (auto x : v) {
+			if (even(x)) total += clamp(square(x));
+		}
+		return total;
+	};
+	auto fused = [&]() {
+		return views::foldl(views::from(v) | views::filter(even) | views::transform(square) | views::transform(clamp), plus<>(), 0ll);
+	};
+	auto materialized = [&]() {
+		vector<int> evens, squares, clamped;
+		copy_if(v.begin(), v.end(), back_inserter(evens), even);
+		std::transform(evens.begin(), evens.end(), back_inserter(squares), square);
+		std::transform(squares.begin(), squares.end(), back_inserter(clamped), clamp);
+		return accumulate(clamped.begin(), clamped.end(), 0ll);
+	};
+	VERIFY_EQ(by_hand(), fused());
+	VERIFY_EQ(by_hand(), materialized());
+
+	benchmark_options options;
+	options.sample_count = 10;
+	auto hand = run_benchmark<chrono::steady_clock>(by_hand, options);
+	auto view = run_benchmark<chrono::steady_clock>(fused, options);
+	auto temporaries = run_benchmark<chrono::steady_clock>(materialized, options);
+	cout << "    " << hand.median.count() << " ns by hand, " << view.median.count() << " ns fused, "
+		<< temporaries.median.count() << " ns with temporaries" << endl;
+	REPORT("by_hand", hand);
+	REPORT("fused", view);
+	REPORT("materialized", temporaries);
+}
+
+TESTFIXTURE(views)
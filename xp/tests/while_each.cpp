@@ -11,6 +11,7 @@
 
 #include "../fakeconcepts.h"
 #include "../benchmark.h"
+#include "../hardware_counters.h"
 #include "testbench.h"
 
 using namespace std;
@@ -213,17 +214,25 @@ TEST(bench_count_while_scenarii) {
 		mt19937 rand(1789);
 		auto generator = bind(distribution, rand);
 		measures<microseconds> m;
+		event_counts events;
+		events.available = ~0u;
 		for (int attempt = 0; attempt != attempts; ++attempt) {
 			auto stop = generator();
 			predicate_t pred {stop};
 
+			counting_timer c;
 			timer<high_resolution_clock> w;
 			if (stop != scenario.second(v, pred))
 				throw runtime_error("Invalid algorithm");
 
 			m += w.elapsed<microseconds>();
+			events += c.elapsed();
 		}
 		cout << "  " << scenario.first << " took an average of " << m.avg().count() << " us." << endl;
+		if (events.has(hardware_event::cycles) && events.has(hardware_event::instructions))
+			cout << "    ipc: " << events.ipc() << endl;
+		if (events.has(hardware_event::branch_misses))
+			cout << "    branch misses per attempt: " << events[hardware_event::branch_misses] / attempts << endl;
 	}
 }
 
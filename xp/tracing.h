@@ -0,0 +1,227 @@
+#ifndef __TRACING_H__
+#define __TRACING_H__
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define XP_TRACE_RDTSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define XP_TRACE_RDTSC
+#endif
+
+// Scoped tracing zones. Each zone writes its name and its start and end timestamps in a
+// ring buffer owned by the calling thread, so recording a zone takes no lock and, with the
+// time stamp counter, only a few nanoseconds.
+// The traces can be exported in the Chrome trace event format, for chrome://tracing or Perfetto.
+//
+// The zones are recorded only when XP_TRACING is defined. Otherwise XP_TRACE_ZONE makes a
+// trace_zone_disabled, an empty object. The two are different types, so that the translation
+// units of a program may be built with and without XP_TRACING.
+
+#define XP_TRACE_CONCAT_(a, b) a##b
+#define XP_TRACE_CONCAT(a, b) XP_TRACE_CONCAT_(a, b)
+
+#ifdef XP_TRACING
+// The name must outlive the export, a string literal for instance.
+#define XP_TRACE_ZONE(name) xp::trace_zone XP_TRACE_CONCAT(xp_trace_zone_, __LINE__)(name)
+#else
+#define XP_TRACE_ZONE(name) xp::trace_zone_disabled XP_TRACE_CONCAT(xp_trace_zone_, __LINE__)(name)
+#endif
+
+namespace xp {
+
+	// Ticks of the time stamp counter when available, nanoseconds of the steady_clock otherwise.
+	struct trace_clock {
+		static std::uint64_t now() {
+#ifdef XP_TRACE_RDTSC
+			return __rdtsc();
+#else
+			return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+		}
+	};
+
+	struct trace_event {
+		const char* name;
+		std::uint64_t start;
+		std::uint64_t end;
+	};
+
+	// Written only by its thread. The oldest events are overwritten when the buffer is full.
+	class trace_buffer {
+	public:
+		static const std::size_t capacity = 1 << 14; // a power of 2
+
+	private:
+		trace_event events[capacity];
+		std::atomic<std::uint64_t> head; // count of the events ever written
+		unsigned id;
+		std::atomic<bool> alive;
+
+		friend class trace_registry;
+
+	public:
+		explicit trace_buffer(unsigned id) : head(0), id(id), alive(true) {}
+
+		trace_buffer(const trace_buffer&) = delete;
+		trace_buffer& operator=(const trace_buffer&) = delete;
+
+		unsigned thread() const {
+			return id;
+		}
+
+		void push(const char* name, std::uint64_t start, std::uint64_t end) {
+			auto h = head.load(std::memory_order_relaxed);
+			events[h & (capacity - 1)] = {name, start, end};
+			head.store(h + 1, std::memory_order_release);
+		}
+
+		// Appends the events still in the buffer to r, the oldest first, and returns the count of the dropped ones.
+		// When the thread records while being read, the events overwritten during the copy are dropped as well.
+		std::uint64_t copy(std::vector<trace_event>& r) const {
+			auto last = head.load(std::memory_order_acquire);
+			auto first = last > capacity ? last - capacity : 0;
+			auto size = r.size();
+			for (auto i = first; i != last; ++i)
+				r.push_back(events[i & (capacity - 1)]);
+			auto now = head.load(std::memory_order_acquire);
+			auto valid = now > capacity ? now - capacity : 0;
+			if (valid > first) {
+				auto torn = static_cast<std::size_t>(std::min(valid, last) - first);
+				r.erase(r.begin() + size, r.begin() + size + torn);
+				first += torn;
+			}
+			return first;
+		}
+	};
+
+	// Owns the buffers. The buffer of an exiting thread is kept until the next clear,
+	// so that its zones can still be exported.
+	class trace_registry {
+		std::mutex m;
+		std::vector<std::unique_ptr<trace_buffer>> buffers;
+		unsigned next_id;
+		std::uint64_t origin_ticks;
+		std::chrono::steady_clock::time_point origin_time;
+
+		trace_registry() : next_id(1), origin_ticks(trace_clock::now()), origin_time(std::chrono::steady_clock::now()) {}
+
+		struct handle {
+			trace_buffer* p;
+			handle() : p(global().acquire()) {}
+			~handle() { p->alive.store(false, std::memory_order_release); }
+		};
+
+		trace_buffer* acquire() {
+			std::lock_guard<std::mutex> lock(m);
+			buffers.emplace_back(new trace_buffer(next_id++));
+			return buffers.back().get();
+		}
+
+	public:
+		trace_registry(const trace_registry&) = delete;
+		trace_registry& operator=(const trace_registry&) = delete;
+
+		// leaked on purpose, threads may exit after the static destructors ran.
+		static trace_registry& global() {
+			static trace_registry* instance = new trace_registry;
+			return *instance;
+		}
+
+		static trace_buffer& local() {
+			static thread_local handle h;
+			return *h.p;
+		}
+
+		// Must not be called while other threads are tracing.
+		void clear() {
+			std::lock_guard<std::mutex> lock(m);
+			std::vector<std::unique_ptr<trace_buffer>> kept;
+			for (auto& b : buffers) {
+				if (!b->alive.load(std::memory_order_acquire)) continue;
+				b->head.store(0, std::memory_order_relaxed);
+				kept.push_back(std::move(b));
+			}
+			buffers.swap(kept);
+		}
+
+		// Writes the zones of all the threads as complete events, with timestamps in microseconds
+		// since the creation of the registry. Returns the count of the events dropped because a buffer was full.
+		std::uint64_t write_chrome_trace(std::ostream& os) {
+			std::lock_guard<std::mutex> lock(m);
+			double ticks_per_us = 1000.;
+#ifdef XP_TRACE_RDTSC
+			auto ticks = trace_clock::now() - origin_ticks;
+			auto us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - origin_time).count();
+			if (us > 0. && ticks > 0) ticks_per_us = ticks / us;
+#endif
+			std::uint64_t dropped = 0;
+			const char* sep = "\n";
+			os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+			std::vector<trace_event> events;
+			for (auto& b : buffers) {
+				events.clear();
+				dropped += b->copy(events);
+				for (auto& e : events) {
+					os << sep << "{\"name\":\"";
+					for (auto c = e.name; *c; ++c) {
+						if (*c == '"' || *c == '\\') os << '\\';
+						os << *c;
+					}
+					os << "\",\"cat\":\"xp\",\"ph\":\"X\",\"pid\":1,\"tid\":" << b->thread()
+						<< ",\"ts\":" << (e.start - origin_ticks) / ticks_per_us
+						<< ",\"dur\":" << (e.end - e.start) / ticks_per_us << "}";
+					sep = ",\n";
+				}
+			}
+			os << "\n]}\n";
+			return dropped;
+		}
+
+		std::uint64_t save_chrome_trace(const std::string& path) {
+			std::ofstream os(path);
+			if (!os) throw std::runtime_error("cannot open " + path);
+			return write_chrome_trace(os);
+		}
+	};
+
+	class trace_zone {
+		trace_buffer* buffer;
+		const char* name;
+		std::uint64_t start;
+
+	public:
+		// the buffer is acquired before the start, so that the first zone of the process starts after the origin.
+		explicit trace_zone(const char* name) : buffer(&trace_registry::local()), name(name), start(trace_clock::now()) {}
+		~trace_zone() {
+			buffer->push(name, start, trace_clock::now());
+		}
+
+		trace_zone(const trace_zone&) = delete;
+		trace_zone& operator=(const trace_zone&) = delete;
+	};
+
+	class trace_zone_disabled {
+	public:
+		explicit trace_zone_disabled(const char*) {}
+
+		trace_zone_disabled(const trace_zone_disabled&) = delete;
+		trace_zone_disabled& operator=(const trace_zone_disabled&) = delete;
+	};
+
+} // namespace xp
+
+#endif __TRACING_H__
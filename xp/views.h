@@ -0,0 +1,368 @@
+#ifndef __VIEWS_H__
+#define __VIEWS_H__
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+#include "fakeconcepts.h"
+#include "algorithm.h"
+
+// Lazy views over the ranges of algorithm.h. A view is a source, looping over a range, followed by
+// the stages applied to each of its elements, and is consumed by a terminal algorithm:
+//
+//	auto v = views::from(make_counted_range(first, n)) | views::filter(is_valid) | views::transform(price);
+//	auto total = views::foldl(v, std::plus<>(), 0.);
+//
+// Each stage wraps the sink of the next one, so the whole pipeline is a single function object that
+// the compiler inlines in the loop of the source: no intermediate container is made and the loop is
+// the one that would be written by hand. A sink returns false to stop the loop early, for take_while.
+//
+// zip and chunk make sources, so they take ranges, and the stages apply to the pairs or to the chunks.
+// The views keep iterators, not containers, so the ranges must outlive them.
+
+namespace xp {
+
+	namespace views {
+
+		namespace details {
+
+			// The sources are cursors: done, get and next, plus position and skip for chunk.
+
+			template<ForwardIterator I>
+			struct bounded_source {
+				typedef I iterator;
+				typedef typename std::iterator_traits<I>::reference reference;
+				typedef typename std::iterator_traits<I>::difference_type difference_type;
+
+				I first;
+				I last;
+
+				bool done() const { return first == last; }
+				reference get() const { return *first; }
+				void next() { ++first; }
+				I position() const { return first; }
+
+				// advances by up to n elements and returns by how many.
+				difference_type skip(difference_type n) {
+					return skip(n, typename std::iterator_traits<I>::iterator_category());
+				}
+
+			private:
+				difference_type skip(difference_type n, std::random_access_iterator_tag) {
+					n = std::min(n, last - first);
+					first += n;
+					return n;
+				}
+				difference_type skip(difference_type n, std::forward_iterator_tag) {
+					difference_type m = 0;
+					for (; m != n && first != last; ++m) ++first;
+					return m;
+				}
+			};
+
+			template<ForwardIterator I>
+			struct counted_source {
+				typedef I iterator;
+				typedef typename std::iterator_traits<I>::reference reference;
+				typedef typename std::iterator_traits<I>::difference_type difference_type;
+
+				I first;
+				difference_type n;
+
+				bool done() const { return n == 0; }
+				reference get() const { return *first; }
+				void next() { ++first; --n; }
+				I position() const { return first; }
+
+				difference_type skip(difference_type k) {
+					k = std::min(k, n);
+					std::advance(first, k);
+					n -= k;
+					return k;
+				}
+			};
+
+			// the guard is called with the iterator, as in copy_while.
+			template<InputIterator I, UnaryPredicate Guard>
+			struct guarded_source {
+				typedef I iterator;
+				typedef typename std::iterator_traits<I>::reference reference;
+				typedef typename std::iterator_traits<I>::difference_type difference_type;
+
+				I first;
+				Guard guard;
+
+				bool done() const { return !guard(first); }
+				reference get() const { return *first; }
+				void next() { ++first; }
+				I position() const { return first; }
+
+				difference_type skip(difference_type n) {
+					difference_type m = 0;
+					for (; m != n && guard(first); ++m) ++first;
+					return m;
+				}
+			};
+
+			// stops at the end of the shorter source.
+			template<typename S1, typename S2>
+			struct zip_source {
+				typedef std::pair<typename S1::reference, typename S2::reference> reference;
+
+				S1 s1;
+				S2 s2;
+
+				bool done() const { return s1.done() || s2.done(); }
+				reference get() const { return reference(s1.get(), s2.get()); }
+				void next() { s1.next(); s2.next(); }
+			};
+
+			// the chunks are counted ranges of k elements, the last one possibly shorter.
+			template<typename S>
+			struct chunk_source {
+				typedef typename S::iterator iterator;
+				typedef typename S::difference_type difference_type;
+				typedef counted_range<iterator> reference;
+
+				S s;
+				difference_type k;
+				iterator start;
+				difference_type n;
+
+				chunk_source(S s, difference_type k) : s(s), k(k) {
+					next();
+				}
+
+				bool done() const { return n == 0; }
+				reference get() const { return reference(start, n); }
+				void next() {
+					start = s.position();
+					n = s.skip(k);
+				}
+			};
+
+			template<ForwardIterator I>
+			bounded_source<I> source_of(bounded_range<I> r) {
+				return{ r.first, r.last };
+			}
+
+			template<ForwardIterator I>
+			counted_source<I> source_of(counted_range<I> r) {
+				return{ r.first, r.n };
+			}
+
+			template<InputIterator I, UnaryPredicate Guard>
+			guarded_source<I, Guard> source_of(guarded_range<I, Guard> r) {
+				return{ r.first, r.guard };
+			}
+
+			// a container or an array, held by reference.
+			template<Range R>
+			auto source_of(R& r) -> bounded_source<decltype(std::begin(r))> {
+				return{ std::begin(r), std::end(r) };
+			}
+
+			template<typename S, typename Sink>
+			bool run(S& s, Sink& sink) {
+				for (; !s.done(); s.next()) {
+					if (!sink(s.get())) return false;
+				}
+				return true;
+			}
+
+			struct no_stage {
+				template<typename Sink>
+				Sink bind(Sink sink) const { return sink; }
+			};
+
+			template<typename Stage1, typename Stage2>
+			struct composed_stage {
+				Stage1 stage1;
+				Stage2 stage2;
+
+				template<typename Sink>
+				auto bind(Sink sink) const -> decltype(stage1.bind(stage2.bind(sink))) {
+					return stage1.bind(stage2.bind(sink));
+				}
+			};
+
+			template<typename Op, typename Sink>
+			struct transform_sink {
+				Op op;
+				Sink sink;
+
+				template<typename T>
+				bool operator()(T&& x) { return sink(op(std::forward<T>(x))); }
+			};
+
+			template<typename Pred, typename Sink>
+			struct filter_sink {
+				Pred pred;
+				Sink sink;
+
+				template<typename T>
+				bool operator()(T&& x) { return !pred(x) || sink(std::forward<T>(x)); }
+			};
+
+			template<typename Pred, typename Sink>
+			struct take_while_sink {
+				Pred pred;
+				Sink sink;
+
+				template<typename T>
+				bool operator()(T&& x) { return pred(x) && sink(std::forward<T>(x)); }
+			};
+
+			// counts down to the next element passed on, so that the loop has no division.
+			template<typename Sink>
+			struct stride_sink {
+				Sink sink;
+				std::size_t k;
+				std::size_t skipped;
+
+				template<typename T>
+				bool operator()(T&& x) {
+					if (skipped != 0) {
+						--skipped;
+						return true;
+					}
+					skipped = k - 1;
+					return sink(std::forward<T>(x));
+				}
+			};
+
+		} // namespace details
+
+		template<typename Op>
+		struct transform_stage {
+			Op op;
+
+			template<typename Sink>
+			details::transform_sink<Op, Sink> bind(Sink sink) const { return{ op, sink }; }
+		};
+
+		template<typename Pred>
+		struct filter_stage {
+			Pred pred;
+
+			template<typename Sink>
+			details::filter_sink<Pred, Sink> bind(Sink sink) const { return{ pred, sink }; }
+		};
+
+		template<typename Pred>
+		struct take_while_stage {
+			Pred pred;
+
+			template<typename Sink>
+			details::take_while_sink<Pred, Sink> bind(Sink sink) const { return{ pred, sink }; }
+		};
+
+		struct stride_stage {
+			std::size_t k;
+
+			template<typename Sink>
+			details::stride_sink<Sink> bind(Sink sink) const { return{ sink, k, 0 }; }
+		};
+
+		template<typename Source, typename Stage = details::no_stage>
+		class view {
+			Source source;
+			Stage stage;
+
+		public:
+			typedef Source source_type;
+			typedef Stage stage_type;
+
+			view(Source source, Stage stage = Stage()) : source(source), stage(stage) {}
+
+			// Calls sink with each element until it returns false. Returns false if it did.
+			template<typename Sink>
+			bool run(Sink sink) const {
+				auto s = source;
+				auto bound = stage.bind(sink);
+				return details::run(s, bound);
+			}
+
+			template<typename Next>
+			inline friend view<Source, details::composed_stage<Stage, Next>> operator|(const view& v, Next next) {
+				return{ v.source, details::composed_stage<Stage, Next>{ v.stage, next } };
+			}
+		};
+
+		// Sources
+
+		template<typename R>
+		auto from(R&& r) -> view<decltype(details::source_of(std::forward<R>(r)))> {
+			return{ details::source_of(std::forward<R>(r)) };
+		}
+
+		template<typename R1, typename R2>
+		auto zip(R1&& r1, R2&& r2) -> view<details::zip_source<decltype(details::source_of(std::forward<R1>(r1))), decltype(details::source_of(std::forward<R2>(r2)))>> {
+			return{ { details::source_of(std::forward<R1>(r1)), details::source_of(std::forward<R2>(r2)) } };
+		}
+
+		// the range must be forward, each chunk is a view of k consecutive elements.
+		template<typename R, Integer N>
+		auto chunk(R&& r, N k) -> view<details::chunk_source<decltype(details::source_of(std::forward<R>(r)))>> {
+			typedef details::chunk_source<decltype(details::source_of(std::forward<R>(r)))> source;
+			return{ source(details::source_of(std::forward<R>(r)), typename source::difference_type(k)) };
+		}
+
+		// Stages
+
+		template<UnaryOperation Op>
+		transform_stage<Op> transform(Op op) {
+			return{ op };
+		}
+
+		template<UnaryPredicate Pred>
+		filter_stage<Pred> filter(Pred pred) {
+			return{ pred };
+		}
+
+		template<UnaryPredicate Pred>
+		take_while_stage<Pred> take_while(Pred pred) {
+			return{ pred };
+		}
+
+		// every k-th element, starting with the first one. k must be positive.
+		template<Integer N>
+		stride_stage stride(N k) {
+			return{ std::size_t(k) };
+		}
+
+		// Terminal algorithms
+
+		template<typename Source, typename Stage, Function F>
+		F for_each(const view<Source, Stage>& v, F f) {
+			v.run([&f](auto&& x) { f(std::forward<decltype(x)>(x)); return true; });
+			return f;
+		}
+
+		template<typename Source, typename Stage, OutputIterator O>
+		O copy(const view<Source, Stage>& v, O out) {
+			v.run([&out](auto&& x) { *out = std::forward<decltype(x)>(x); ++out; return true; });
+			return out;
+		}
+
+		template<typename Source, typename Stage, BinaryOperation Op, typename T>
+		T foldl(const view<Source, Stage>& v, Op op, T z) {
+			v.run([&](auto&& x) { z = op(z, std::forward<decltype(x)>(x)); return true; });
+			return z;
+		}
+
+		template<typename Source, typename Stage>
+		std::size_t count(const view<Source, Stage>& v) {
+			std::size_t n = 0;
+			v.run([&n](auto&&) { ++n; return true; });
+			return n;
+		}
+
+	} // namespace views
+
+} // namespace xp
+
+#endif __VIEWS_H__